@@ -2,7 +2,9 @@
 // FILE: adjacency_list.h
 // AUTH: Zach Sahlin
 // DATE: Fall 2022
-// DESC: Represents a graph as an adjacency list
+// DESC: Represents a graph as an adjacency list. The allocator type
+//       is used for the per-edge list nodes (see node_pool.h for a
+//       pooled allocator).
 //----------------------------------------------------------------------
 
 
@@ -11,17 +13,37 @@
 
 #include <set>
 #include <list>
+#include <memory>
 #include <algorithm>
 #include "graph.h"
+#include "node_pool.h"
 
 
 template<typename T>
+class GraphBuilder;
+
+template<typename T, typename Alloc = std::allocator<std::pair<std::optional<T>,int>>>
 class AdjacencyList : public Graph<T>
 {
 public:
   
-  // constructor that creates a graph with n nodes
-  AdjacencyList(int n, bool is_directed);
+  // constructor that creates a graph with n nodes whose edges are
+  // allocated with the given allocator
+  AdjacencyList(int n, bool is_directed, const Alloc& alloc = Alloc());
+
+  // copy constructor (the copy gets the allocator returned by the
+  // allocator's select_on_container_copy_construction)
+  AdjacencyList(const AdjacencyList& other);
+
+  // copy assignment operator
+  AdjacencyList& operator=(const AdjacencyList& other);
+
+  // move constructor and move assignment operator
+  AdjacencyList(AdjacencyList&& other) = default;
+  AdjacencyList& operator=(AdjacencyList&& other) = default;
+
+  // Returns the allocator used for the edges
+  Alloc get_allocator() const;
   
   // Returns true if the graph is directed and false otherwise. Note
   // that an edge (x,y) in an undirected graph always has a
@@ -54,6 +76,10 @@ public:
   // edges (i.e., the direct successors of x).  
   std::vector<int> out_nodes(int x) const;
 
+  // Returns the outgoing edges of x as (label, node) pairs, in the
+  // same order as out_nodes(x).
+  std::vector<std::pair<std::optional<T>,int>> out_edges(int x) const;
+
   // Returns the list of nodes that x is connected to on its incoming
   // edges (i.e., the direct predecessors of x).
   std::vector<int> in_nodes(int x) const;
@@ -73,6 +99,13 @@ public:
   int edge_count() const;
 
 private:
+  // one linked list of (label, node) pairs per node
+  typedef std::list<std::pair<std::optional<T>,int>, Alloc> EdgeList;
+
+  // the builder fills adj_list directly (see graph_builder.h)
+  template<typename U>
+  friend class GraphBuilder;
+
   // the total number of nodes and edges
   int nodes;
   int edges;
@@ -80,24 +113,60 @@ private:
   // true if the graph is directed
   bool directed;
 
+  // allocator shared by all of the lists
+  Alloc allocator;
+
   // underlying list representation with n linked lists
-  std::vector<std::list<std::pair<std::optional<T>,int>>> adj_list;
+  std::vector<EdgeList> adj_list;
 };
 
-template<typename T>
-AdjacencyList<T>::AdjacencyList(int n, bool is_directed) : adj_list(n, std::list<std::pair<std::optional<T>,int>>()) {
+template<typename T, typename Alloc>
+AdjacencyList<T,Alloc>::AdjacencyList(int n, bool is_directed, const Alloc& alloc) : allocator(alloc) {
   directed = is_directed;
   nodes = n;
   edges = 0;
+
+  // each list shares the one allocator
+  adj_list.reserve(n);
+  for (int i = 0; i < n; i++) {
+    adj_list.emplace_back(allocator);
+  }
 }
 
-template<typename T>
-bool AdjacencyList<T>::is_directed() const {
+template<typename T, typename Alloc>
+AdjacencyList<T,Alloc>::AdjacencyList(const AdjacencyList& other)
+  : allocator(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.allocator)) {
+  directed = other.directed;
+  nodes = other.nodes;
+  edges = other.edges;
+
+  adj_list.reserve(nodes);
+  for (const EdgeList& row : other.adj_list) {
+    adj_list.emplace_back(row.begin(), row.end(), allocator);
+  }
+}
+
+template<typename T, typename Alloc>
+AdjacencyList<T,Alloc>& AdjacencyList<T,Alloc>::operator=(const AdjacencyList& other) {
+  if (this != &other) {
+    AdjacencyList copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+template<typename T, typename Alloc>
+Alloc AdjacencyList<T,Alloc>::get_allocator() const {
+  return allocator;
+}
+
+template<typename T, typename Alloc>
+bool AdjacencyList<T,Alloc>::is_directed() const {
   return directed;
 }
 
-template<typename T>
-bool AdjacencyList<T>::has_edge(int x, int y) const {
+template<typename T, typename Alloc>
+bool AdjacencyList<T,Alloc>::has_edge(int x, int y) const {
   // check for invalid nodes
   if (x < 0 || x >= nodes || y < 0 || y >= nodes) {
     return false;
@@ -111,8 +180,8 @@ bool AdjacencyList<T>::has_edge(int x, int y) const {
   return false;
 }
 
-template<typename T>
-void AdjacencyList<T>::add_edge(int x, std::optional<T> label, int y) {
+template<typename T, typename Alloc>
+void AdjacencyList<T,Alloc>::add_edge(int x, std::optional<T> label, int y) {
   // check for invalid nodes
   if (x < 0 || x >= nodes || y < 0 || y >= nodes) {
     return;
@@ -136,8 +205,8 @@ void AdjacencyList<T>::add_edge(int x, std::optional<T> label, int y) {
   edges++;
 }
 
-template<typename T>
-void AdjacencyList<T>::rem_edge(int x, int y) {  
+template<typename T, typename Alloc>
+void AdjacencyList<T,Alloc>::rem_edge(int x, int y) {  
   for (auto it = adj_list[x].begin(); it != adj_list[x].end(); ++it) {
     if (it->second == y) {
       adj_list[x].erase(it);
@@ -159,9 +228,9 @@ void AdjacencyList<T>::rem_edge(int x, int y) {
   }
 }
 
-template<typename T>
-std::optional<T> AdjacencyList<T>::get_label(int x, int y) const {
-  std::list<std::pair<std::optional<T>, int>> row = adj_list.at(x);
+template<typename T, typename Alloc>
+std::optional<T> AdjacencyList<T,Alloc>::get_label(int x, int y) const {
+  const EdgeList& row = adj_list.at(x);
   
   for (auto it = row.begin(); it != row.end(); ++it) {
     if (it->second == y) {
@@ -172,8 +241,8 @@ std::optional<T> AdjacencyList<T>::get_label(int x, int y) const {
   return std::nullopt;
 }
 
-template<typename T>
-void AdjacencyList<T>::set_label(int x, const T& label, int y) {
+template<typename T, typename Alloc>
+void AdjacencyList<T,Alloc>::set_label(int x, const T& label, int y) {
   for (auto it = adj_list[x].begin(); it != adj_list[x].end(); ++it) {
     if (it->second == y) {
       it->first = std::make_optional<T>(label);
@@ -194,14 +263,14 @@ void AdjacencyList<T>::set_label(int x, const T& label, int y) {
   }
 }
 
-template<typename T>
-std::vector<int> AdjacencyList<T>::out_nodes(int x) const {
+template<typename T, typename Alloc>
+std::vector<int> AdjacencyList<T,Alloc>::out_nodes(int x) const {
   // check for invalid nodes
   if (x < 0 || x >= nodes) {
     return std::vector<int>();
   }
 
-  std::list<std::pair<std::optional<T>, int>> row = adj_list.at(x);  // get the row at x
+  const EdgeList& row = adj_list.at(x);  // get the row at x
 
   std::vector<int> nodes;  // new vector for out_nodes
 
@@ -212,8 +281,19 @@ std::vector<int> AdjacencyList<T>::out_nodes(int x) const {
   return nodes;
 }
 
-template<typename T>
-std::vector<int> AdjacencyList<T>::in_nodes(int x) const {
+template<typename T, typename Alloc>
+std::vector<std::pair<std::optional<T>,int>> AdjacencyList<T,Alloc>::out_edges(int x) const {
+  // check for invalid nodes
+  if (x < 0 || x >= nodes) {
+    return std::vector<std::pair<std::optional<T>,int>>();
+  }
+
+  const EdgeList& row = adj_list[x];
+  return std::vector<std::pair<std::optional<T>,int>>(row.begin(), row.end());
+}
+
+template<typename T, typename Alloc>
+std::vector<int> AdjacencyList<T,Alloc>::in_nodes(int x) const {
   // check for invalid nodes
   if (x < 0 || x >= nodes) {
     return std::vector<int>();
@@ -234,8 +314,8 @@ std::vector<int> AdjacencyList<T>::in_nodes(int x) const {
   return nodes;
 }
 
-template<typename T>
-std::vector<int> AdjacencyList<T>::adjacent(int x) const {
+template<typename T, typename Alloc>
+std::vector<int> AdjacencyList<T,Alloc>::adjacent(int x) const {
     
   std::vector<int> out = out_nodes(x);
   std::vector<int> in = in_nodes(x);
@@ -259,15 +339,20 @@ std::vector<int> AdjacencyList<T>::adjacent(int x) const {
   return combined;
 }
 
-template<typename T>
-int AdjacencyList<T>::node_count() const {
+template<typename T, typename Alloc>
+int AdjacencyList<T,Alloc>::node_count() const {
   return nodes;
 }
 
-template<typename T>
-int AdjacencyList<T>::edge_count() const {
+template<typename T, typename Alloc>
+int AdjacencyList<T,Alloc>::edge_count() const {
   return edges;
 }
 
 
+// adjacency list whose edges come from a per-graph node pool
+template<typename T>
+using PooledAdjacencyList = AdjacencyList<T, PoolAllocator<std::pair<std::optional<T>,int>>>;
+
+
 #endif
@@ -0,0 +1,63 @@
+//----------------------------------------------------------------------
+// FILE: algorithm_stats.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Opt-in hot-path counters for the shortest path engines. The
+//       counters are only updated when compiled with APSP_STATS
+//       defined (e.g., cmake -DAPSP_STATS=ON). Otherwise the counting
+//       statements compile to nothing and the counters stay zero.
+//----------------------------------------------------------------------
+
+
+#ifndef ALGORITHM_STATS_H
+#define ALGORITHM_STATS_H
+
+
+struct AlgorithmStats
+{
+  // number of edges examined for a shorter path (including pivot
+  // checks in floyd warshall)
+  long long relaxations = 0;
+
+  // number of relaxations that lowered a distance
+  long long successful_relaxations = 0;
+
+  // insertions into and extractions from dijkstra's priority queue
+  long long heap_pushes = 0;
+  long long heap_pops = 0;
+
+  // number of passes over the edge set in bellman ford
+  long long bellman_ford_rounds = 0;
+
+  // number of intermediate (k) phases run by floyd warshall
+  long long pivot_phases = 0;
+
+  // bytes of working storage allocated by the engines
+  long long bytes_allocated = 0;
+
+  // adds the counts in other to these counts
+  AlgorithmStats& operator+=(const AlgorithmStats& other)
+  {
+    relaxations += other.relaxations;
+    successful_relaxations += other.successful_relaxations;
+    heap_pushes += other.heap_pushes;
+    heap_pops += other.heap_pops;
+    bellman_ford_rounds += other.bellman_ford_rounds;
+    pivot_phases += other.pivot_phases;
+    bytes_allocated += other.bytes_allocated;
+    return *this;
+  }
+};
+
+
+// adds amount to the given counter of stats (an AlgorithmStats
+// pointer, may be null)
+#ifdef APSP_STATS
+#define APSP_STAT(stats, counter, amount) \
+  do { if (stats) (stats)->counter += (amount); } while (0)
+#else
+#define APSP_STAT(stats, counter, amount) do { } while (0)
+#endif
+
+
+#endif
@@ -0,0 +1,344 @@
+//----------------------------------------------------------------------
+// FILE: alt_search.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: ALT (A*, landmarks, triangle inequality) point-to-point
+//       search. A few landmark nodes are chosen and the distances to
+//       and from each of them are precomputed. Queries are A* searches
+//       using the triangle inequality bounds from the landmarks as the
+//       heuristic, which steers the search toward the target and can
+//       rule out nodes that can't reach it at all. Assumes
+//       non-negative edge labels.
+//----------------------------------------------------------------------
+
+
+#ifndef ALT_SEARCH_H
+#define ALT_SEARCH_H
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include "graph.h"
+#include "static_graph.h"
+#include "graph_builder.h"
+#include "graph_algorithms.h"
+#include "algorithm_stats.h"
+
+
+// how landmarks are chosen
+enum class LandmarkSelection
+{
+  farthest,  // repeatedly the node farthest from the chosen landmarks
+  avoid      // leaves of poorly covered shortest path subtrees
+};
+
+
+class AltSearch
+{
+public:
+
+  // Constructor that chooses the given number of landmarks (at most
+  // the node count) and computes the distances to and from them. The
+  // seed picks the (random) start nodes used by the selection.
+  AltSearch(const Graph<int>& g, int landmark_count = 16,
+            LandmarkSelection selection = LandmarkSelection::avoid,
+            unsigned long long seed = 1);
+
+  // Returns the shortest path cost from s to t, or
+  // numeric_limits<int>::max() if t is unreachable from s. Uses
+  // internal search buffers, so a single index shouldn't be queried
+  // from more than one thread at a time.
+  int distance(int s, int t, AlgorithmStats* stats = nullptr) const;
+
+  // Returns the landmark lower bound on the cost from x to t, or
+  // numeric_limits<int>::max() if the landmarks show t is unreachable
+  // from x.
+  int lower_bound(int x, int t) const;
+
+  // Returns the chosen landmarks
+  const std::vector<int>& landmarks() const;
+
+  // Returns the total number of nodes in the graph.
+  int node_count() const;
+
+private:
+  typedef std::pair<long long,int> Entry;  // (key, node)
+  typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> MinHeap;
+
+  static constexpr int unreachable = std::numeric_limits<int>::max();
+
+  int nodes;
+  StaticGraph sg;
+  std::vector<int> chosen;
+
+  // distances from and to landmark i for node x at x * k + i (node
+  // major, so computing a bound reads one contiguous block)
+  std::vector<int> from_landmark;
+  std::vector<int> to_landmark;
+
+  // query buffers (reset through the touched list)
+  mutable std::vector<long long> dist;
+  mutable std::vector<int> bound;
+  mutable std::vector<bool> settled;
+  mutable std::vector<int> touched;
+
+  // adds x as the next landmark (running the sssp engine both ways)
+  void add_landmark(int x, const AdjacencyList<int>& forward, const AdjacencyList<int>& reverse);
+
+  // returns the next landmark by the farthest rule
+  int farthest_node(std::mt19937_64& random) const;
+
+  // returns the next landmark by the avoid rule
+  int avoid_node(std::mt19937_64& random, const AdjacencyList<int>& forward) const;
+};
+
+
+inline AltSearch::AltSearch(const Graph<int>& g, int landmark_count, LandmarkSelection selection,
+                            unsigned long long seed)
+  : nodes(g.node_count()), sg(g), dist(g.node_count(), -1), bound(g.node_count(), -1),
+    settled(g.node_count(), false) {
+  // directed copies of g and its reverse for the sssp engine
+  GraphBuilder<int> forward_builder(nodes, true);
+  GraphBuilder<int> reverse_builder(nodes, true);
+  for (int x = 0; x < nodes; x++) {
+    for (const auto& arc : sg.out_arcs(x)) {
+      forward_builder.add_edge(x, arc.label, arc.node);
+      reverse_builder.add_edge(arc.node, arc.label, x);
+    }
+  }
+  AdjacencyList<int> forward = forward_builder.build();
+  AdjacencyList<int> reverse = reverse_builder.build();
+
+  std::mt19937_64 random(seed);
+  landmark_count = std::min(landmark_count, nodes);
+  while ((int) chosen.size() < landmark_count) {
+    int x = selection == LandmarkSelection::farthest ? farthest_node(random) : avoid_node(random, forward);
+    if (x < 0) {
+      break;
+    }
+    add_landmark(x, forward, reverse);
+  }
+}
+
+inline void AltSearch::add_landmark(int x, const AdjacencyList<int>& forward, const AdjacencyList<int>& reverse) {
+  std::vector<int> zero(nodes, 0);
+  std::vector<int> from = GraphAlgorithms<int>::johnsons_query(forward, zero, x);
+  std::vector<int> to = GraphAlgorithms<int>::johnsons_query(reverse, zero, x);
+
+  // widen the node major tables by one column
+  int k = chosen.size();
+  std::vector<int> new_from(nodes * (k + 1));
+  std::vector<int> new_to(nodes * (k + 1));
+  for (int y = 0; y < nodes; y++) {
+    std::copy(from_landmark.begin() + y * k, from_landmark.begin() + (y + 1) * k, new_from.begin() + y * (k + 1));
+    std::copy(to_landmark.begin() + y * k, to_landmark.begin() + (y + 1) * k, new_to.begin() + y * (k + 1));
+    new_from[y * (k + 1) + k] = from[y];
+    new_to[y * (k + 1) + k] = to[y];
+  }
+  from_landmark.swap(new_from);
+  to_landmark.swap(new_to);
+  chosen.push_back(x);
+}
+
+inline int AltSearch::farthest_node(std::mt19937_64& random) const {
+  // the first landmark is a random node
+  if (chosen.empty()) {
+    return random() % nodes;
+  }
+
+  // otherwise the node with the largest round trip to its closest
+  // landmark (unreachable counts as farthest)
+  int k = chosen.size();
+  int best = -1;
+  long long best_dist = -1;
+  for (int x = 0; x < nodes; x++) {
+    long long closest = std::numeric_limits<long long>::max();
+    for (int i = 0; i < k; i++) {
+      long long from = from_landmark[x * k + i];
+      long long to = to_landmark[x * k + i];
+      closest = std::min(closest, from + to);
+    }
+    if (closest > best_dist && closest > 0) {
+      best = x;
+      best_dist = closest;
+    }
+  }
+  return best;
+}
+
+inline int AltSearch::avoid_node(std::mt19937_64& random, const AdjacencyList<int>& forward) const {
+  // shortest path tree from a random root
+  int root = random() % nodes;
+  std::vector<int> zero(nodes, 0);
+  std::vector<int> root_dist = GraphAlgorithms<int>::johnsons_query(forward, zero, root);
+
+  // parents by a breadth first search over tight edges (children come
+  // after their parents in the search order)
+  std::vector<int> parent(nodes, -1);
+  std::vector<int> tree_order;
+  std::vector<bool> seen(nodes, false);
+  seen[root] = true;
+  tree_order.push_back(root);
+  for (size_t i = 0; i < tree_order.size(); i++) {
+    int x = tree_order[i];
+    for (const auto& arc : sg.out_arcs(x)) {
+      if (!seen[arc.node] && (long long) root_dist[x] + arc.label == root_dist[arc.node]) {
+        seen[arc.node] = true;
+        parent[arc.node] = x;
+        tree_order.push_back(arc.node);
+      }
+    }
+  }
+
+  // a subtree's size is how badly the current landmarks bound the
+  // distances to its nodes, or 0 if it already holds a landmark
+  std::vector<long long> size(nodes, 0);
+  std::vector<bool> has_landmark(nodes, false);
+  for (int x : chosen) {
+    has_landmark[x] = true;
+  }
+  for (auto it = tree_order.rbegin(); it != tree_order.rend(); ++it) {
+    int x = *it;
+    int lb = lower_bound(root, x);
+    size[x] += root_dist[x] - (lb == unreachable ? 0 : lb);
+    if (has_landmark[x]) {
+      size[x] = 0;
+    }
+    if (parent[x] >= 0) {
+      has_landmark[parent[x]] = has_landmark[parent[x]] || has_landmark[x];
+      size[parent[x]] += size[x];
+    }
+  }
+
+  // walk down from the largest subtree to a leaf, following the largest
+  // child
+  std::vector<int> best_child(nodes, -1);
+  int start = -1;
+  for (int x : tree_order) {
+    if (start < 0 || size[x] > size[start]) {
+      start = x;
+    }
+    int p = parent[x];
+    if (p >= 0 && size[x] > 0 && (best_child[p] < 0 || size[x] > size[best_child[p]])) {
+      best_child[p] = x;
+    }
+  }
+  if (start < 0 || size[start] == 0) {
+    // every subtree is covered, so fall back to an unused node
+    for (int x = 0; x < nodes; x++) {
+      if (std::find(chosen.begin(), chosen.end(), x) == chosen.end()) {
+        return x;
+      }
+    }
+    return -1;
+  }
+  int x = start;
+  while (best_child[x] >= 0) {
+    x = best_child[x];
+  }
+  return x;
+}
+
+inline int AltSearch::lower_bound(int x, int t) const {
+  int k = chosen.size();
+  const int* from_x = from_landmark.data() + (long long) x * k;
+  const int* from_t = from_landmark.data() + (long long) t * k;
+  const int* to_x = to_landmark.data() + (long long) x * k;
+  const int* to_t = to_landmark.data() + (long long) t * k;
+  int best = 0;
+  for (int i = 0; i < k; i++) {
+    // d(x,t) >= d(L,t) - d(L,x); and if L reaches x but not t, then
+    // x can't reach t either
+    if (from_x[i] != unreachable) {
+      if (from_t[i] == unreachable) {
+        return unreachable;
+      }
+      best = std::max(best, from_t[i] - from_x[i]);
+    }
+    // d(x,t) >= d(x,L) - d(t,L); and if t reaches L but x doesn't, then
+    // x can't reach t
+    if (to_t[i] != unreachable) {
+      if (to_x[i] == unreachable) {
+        return unreachable;
+      }
+      best = std::max(best, to_x[i] - to_t[i]);
+    }
+  }
+  return best;
+}
+
+inline int AltSearch::distance(int s, int t, AlgorithmStats* stats) const {
+  if (s < 0 || s >= nodes || t < 0 || t >= nodes) {
+    return unreachable;
+  }
+  int start_bound = lower_bound(s, t);
+  if (start_bound == unreachable) {
+    return unreachable;
+  }
+
+  // A* keyed on distance plus the (consistent) landmark bound, so the
+  // target's distance is final once it is popped
+  MinHeap heap;
+  dist[s] = 0;
+  bound[s] = start_bound;
+  touched.push_back(s);
+  heap.push(Entry(start_bound, s));
+  APSP_STAT(stats, heap_pushes, 1);
+  long long result = -1;
+
+  while (!heap.empty()) {
+    int x = heap.top().second;
+    heap.pop();
+    APSP_STAT(stats, heap_pops, 1);
+    if (settled[x]) {
+      continue;  // stale entry
+    }
+    settled[x] = true;
+    if (x == t) {
+      result = dist[x];
+      break;
+    }
+
+    for (const auto& arc : sg.out_arcs(x)) {
+      APSP_STAT(stats, relaxations, 1);
+      int y = arc.node;
+      if (bound[y] < 0) {
+        bound[y] = lower_bound(y, t);
+        touched.push_back(y);
+      }
+      if (bound[y] == unreachable) {
+        continue;
+      }
+      long long next = dist[x] + arc.label;
+      if (dist[y] < 0 || next < dist[y]) {
+        dist[y] = next;
+        heap.push(Entry(next + bound[y], y));
+        APSP_STAT(stats, successful_relaxations, 1);
+        APSP_STAT(stats, heap_pushes, 1);
+      }
+    }
+  }
+
+  for (int x : touched) {
+    dist[x] = -1;
+    bound[x] = -1;
+    settled[x] = false;
+  }
+  touched.clear();
+
+  return result < 0 ? unreachable : result;
+}
+
+inline const std::vector<int>& AltSearch::landmarks() const {
+  return chosen;
+}
+
+inline int AltSearch::node_count() const {
+  return nodes;
+}
+
+
+#endif
@@ -0,0 +1,502 @@
+//----------------------------------------------------------------------
+// FILE: apsp_scheduler.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Asynchronous all-pairs jobs on a shared thread pool. A job
+//       keeps its own GraphSnapshot of the graph (submitting a pinned
+//       snapshot shares its edge lists instead of copying them) and is
+//       run as a series of short steps: blocks of Bellman-Ford rounds
+//       for the potentials and then blocks of source rows for
+//       Johnson's, the initial matrix and then blocks of pivots for
+//       Floyd-Warshall. After every step the job goes back in the
+//       queue, so a worker always continues with the most urgent job
+//       and a small interactive job waits at most one step of a large
+//       batch job. Steps also give the progress and the points where
+//       a cancelled job stops.
+//----------------------------------------------------------------------
+
+
+#ifndef APSP_SCHEDULER_H
+#define APSP_SCHEDULER_H
+
+#include <vector>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <exception>
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+#include "graph.h"
+#include "graph_algorithms.h"
+#include "snapshot_graph.h"
+#include "algorithm_stats.h"
+
+
+// the engine a job runs
+enum class ApspEngine
+{
+  johnsons,
+  floyd_warshall
+};
+
+
+// job priority classes, served in this order (and in submission order
+// within a class)
+enum class JobPriority
+{
+  interactive,
+  normal,
+  batch
+};
+
+
+struct ApspJobOptions
+{
+  ApspEngine engine = ApspEngine::johnsons;
+  JobPriority priority = JobPriority::normal;
+  // optional counters to add the job's operation counts to (only
+  // updated when compiled with APSP_STATS; read them once it is done)
+  AlgorithmStats* stats = nullptr;
+};
+
+
+namespace apsp_scheduler {
+
+// one submitted job and its progress through its steps
+struct Job
+{
+  Job(GraphSnapshot g, const ApspJobOptions& options);
+
+  // runs the next step; returns false once the job is finished (with
+  // the result in table)
+  bool step();
+
+  // ends the job with the given result
+  void finish(std::vector<std::vector<int>> result);
+
+  // ends the job with the exception a step threw
+  void fail(std::exception_ptr error);
+
+  GraphSnapshot graph;
+  ApspJobOptions options;
+  long long sequence = 0;  // set when queued
+  int per_step;      // sources or pivots per step
+  int steps_total;
+  std::atomic<int> steps_done{0};
+  std::atomic<bool> cancel_requested{false};
+  std::promise<std::vector<std::vector<int>>> promise;
+  std::shared_future<std::vector<std::vector<int>>> result;
+
+  // engine state
+  int next = 0;                        // next source or pivot
+  int round = 0;                       // johnsons: potential rounds run
+  std::vector<int> potentials;         // johnsons
+  std::vector<std::vector<int>> dists; // johnsons
+  std::vector<int> matrix;             // floyd_warshall (n x n)
+  std::vector<std::vector<int>> table; // the result
+};
+
+// queue order: the top job has the most urgent class and was submitted
+// first within it
+struct JobOrder
+{
+  bool operator()(const std::shared_ptr<Job>& a, const std::shared_ptr<Job>& b) const {
+    return a->options.priority != b->options.priority ? a->options.priority > b->options.priority
+                                                      : a->sequence > b->sequence;
+  }
+};
+
+}  // namespace apsp_scheduler
+
+
+class ApspJob
+{
+public:
+
+  // an empty handle (not for a job)
+  ApspJob() = default;
+
+  // Returns true if this handle is for a job
+  bool valid() const;
+
+  // Returns true once the job has finished (including when cancelled)
+  bool done() const;
+
+  // Returns the fraction of the job's steps that have run, from 0 to 1
+  // (Johnson's potentials count as one step)
+  double progress() const;
+
+  // Asks the job to stop; it finishes with an empty result at its next
+  // step (a finished job is unchanged)
+  void cancel();
+
+  // Returns true if cancel has been called
+  bool cancelled() const;
+
+  // Waits for the job to finish
+  void wait() const;
+
+  // Waits at most timeout for the job; returns true if it finished
+  bool wait_for(std::chrono::milliseconds timeout) const;
+
+  // Waits for and returns the result: the distance table (the same as
+  // the synchronous engine), or an empty table for a negative cycle or
+  // a cancelled job. Rethrows an exception the engine threw (e.g.,
+  // bad_optional_access for an unlabeled edge).
+  const std::vector<std::vector<int>>& get() const;
+
+  // Returns the future the result is delivered through
+  std::shared_future<std::vector<std::vector<int>>> future() const;
+
+private:
+  friend class ApspScheduler;
+  ApspJob(std::shared_ptr<apsp_scheduler::Job> job);
+
+  std::shared_ptr<apsp_scheduler::Job> job;
+};
+
+
+class ApspScheduler
+{
+public:
+
+  // Constructor for a pool of the given number of worker threads (0 =
+  // one per hardware thread)
+  ApspScheduler(int threads = 0);
+
+  // Destructor; cancels the unfinished jobs and waits for the workers
+  ~ApspScheduler();
+
+  ApspScheduler(const ApspScheduler&) = delete;
+  ApspScheduler& operator=(const ApspScheduler&) = delete;
+
+  // Queues an all-pairs job on a copy of g and returns its handle
+  ApspJob submit(const Graph<int>& g, const ApspJobOptions& options = ApspJobOptions());
+
+  // Queues an all-pairs job on a snapshot (e.g., a SnapshotGraph pin's
+  // graph), sharing its edge lists, and returns its handle
+  ApspJob submit(const GraphSnapshot& g, const ApspJobOptions& options = ApspJobOptions());
+
+  // Returns the number of jobs that have not finished
+  int pending_count() const;
+
+  // Returns the number of worker threads
+  int thread_count() const;
+
+  // Returns the process-wide scheduler (one worker per hardware thread)
+  static ApspScheduler& shared();
+
+private:
+  std::vector<std::shared_ptr<apsp_scheduler::Job>> queue;  // a heap in JobOrder
+  std::vector<std::thread> workers;
+  mutable std::mutex lock;
+  std::condition_variable ready;
+  bool stopping = false;
+  long long next_sequence = 0;
+  int pending = 0;
+
+  // worker thread: runs one step of the top job at a time
+  void work();
+
+  // queues a new job and returns its handle
+  ApspJob queue_job(std::shared_ptr<apsp_scheduler::Job> job);
+};
+
+
+//----------------------------------------------------------------------
+// Computes the shortest paths between all pairs of vertices on the
+// shared scheduler and waits for the result. Must not be called from
+// inside a job.
+// Input:
+//  g -- the given directed weighted graph
+//  options -- the engine, priority and stats for the job
+// Output: the same table as the synchronous engine (empty if the graph
+//         has a negative cycle); an exception from the engine is
+//         rethrown
+//----------------------------------------------------------------------
+inline std::vector<std::vector<int>> scheduled_apsp(const Graph<int>& g,
+                                                    const ApspJobOptions& options = ApspJobOptions()) {
+  return ApspScheduler::shared().submit(g, options).get();
+}
+
+
+namespace apsp_scheduler {
+
+// about this many edge relaxations per step
+const long long step_work = 1 << 22;
+
+inline Job::Job(GraphSnapshot g, const ApspJobOptions& options)
+  : graph(std::move(g)), options(options), result(promise.get_future().share()) {
+  long long n = std::max(1, graph.node_count());
+  long long row_work = options.engine == ApspEngine::johnsons ? n + graph.edge_count() : n * n;
+  per_step = std::max(1LL, std::min(n, step_work / row_work));
+  steps_total = 1 + (graph.node_count() + per_step - 1) / per_step;
+}
+
+inline bool Job::step() {
+  const int inf = std::numeric_limits<int>::max();
+  int n = graph.node_count();
+  AlgorithmStats* stats = options.stats;
+
+  if (steps_done == 0 && options.engine == ApspEngine::johnsons) {
+    // the potentials, as johnsons_prepare computes them, but per_step
+    // Bellman-Ford rounds (each costs about as much as a row) at a time
+    if (round == 0) {
+      potentials.assign(n, 0);
+      APSP_STAT(stats, bytes_allocated, potentials.capacity() * sizeof(int));
+    }
+    bool changed = true;
+    for (int last = std::min(n, round + per_step); changed && round < last; round++) {
+      APSP_STAT(stats, bellman_ford_rounds, 1);
+      changed = false;
+      for (int u = 0; u < n; u++) {
+        auto edges = graph.out_edges(u);
+        APSP_STAT(stats, relaxations, edges.size());
+        for (const auto& [label, v] : edges) {
+          if (potentials[u] + label.value() < potentials[v]) {
+            potentials[v] = potentials[u] + label.value();
+            changed = true;
+            APSP_STAT(stats, successful_relaxations, 1);
+          }
+        }
+      }
+    }
+    if (changed) {
+      // a change in round n means a negative cycle
+      return round < n;
+    }
+    dists.resize(n);
+    steps_done++;
+    return true;
+  }
+
+  if (steps_done == 0) {
+    // first floyd_warshall step: the initial matrix
+    matrix.assign((long long) n * n, inf);
+    APSP_STAT(stats, bytes_allocated, (long long) n * n * sizeof(int));
+    for (int u = 0; u < n; u++) {
+      matrix[(long long) u * n + u] = 0;
+      for (const auto& [label, v] : graph.out_edges(u)) {
+        int& entry = matrix[(long long) u * n + v];
+        entry = std::min(v == u ? 0 : entry, label.value());
+      }
+    }
+  } else if (options.engine == ApspEngine::johnsons) {
+    for (int last = std::min(n, next + per_step); next < last; next++) {
+      dists[next] = GraphAlgorithms<int>::johnsons_query(graph, potentials, next, stats);
+      APSP_STAT(stats, bytes_allocated, dists[next].capacity() * sizeof(int));
+    }
+  } else {
+    for (int last = std::min(n, next + per_step); next < last; next++) {
+      APSP_STAT(stats, pivot_phases, 1);
+      const int* row_k = matrix.data() + (long long) next * n;
+      for (int i = 0; i < n; i++) {
+        int* row_i = matrix.data() + (long long) i * n;
+        int ik = row_i[next];
+        if (ik == inf) {
+          continue;
+        }
+        APSP_STAT(stats, relaxations, n);
+        for (int j = 0; j < n; j++) {
+          if (row_k[j] != inf && (long long) ik + row_k[j] < row_i[j]) {
+            row_i[j] = ik + row_k[j];
+            APSP_STAT(stats, successful_relaxations, 1);
+          }
+        }
+      }
+    }
+  }
+  steps_done++;
+  if (next < n) {
+    return true;
+  }
+
+  if (options.engine == ApspEngine::johnsons) {
+    table = std::move(dists);
+    return false;
+  }
+  bool negative_cycle = false;
+  for (int u = 0; u < n; u++) {
+    negative_cycle = negative_cycle || matrix[(long long) u * n + u] < 0;
+  }
+  for (int u = 0; u < n && !negative_cycle; u++) {
+    table.emplace_back(matrix.begin() + (long long) u * n, matrix.begin() + (long long) (u + 1) * n);
+  }
+  std::vector<int>().swap(matrix);
+  return false;
+}
+
+inline void Job::finish(std::vector<std::vector<int>> result) {
+  steps_done = steps_total;
+  promise.set_value(std::move(result));
+}
+
+inline void Job::fail(std::exception_ptr error) {
+  steps_done = steps_total;
+  promise.set_exception(error);
+}
+
+}  // namespace apsp_scheduler
+
+
+inline ApspJob::ApspJob(std::shared_ptr<apsp_scheduler::Job> job) : job(job) {
+}
+
+inline bool ApspJob::valid() const {
+  return job != nullptr;
+}
+
+inline bool ApspJob::done() const {
+  return job->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+inline double ApspJob::progress() const {
+  return (double) job->steps_done / job->steps_total;
+}
+
+inline void ApspJob::cancel() {
+  job->cancel_requested = true;
+}
+
+inline bool ApspJob::cancelled() const {
+  return job->cancel_requested;
+}
+
+inline void ApspJob::wait() const {
+  job->result.wait();
+}
+
+inline bool ApspJob::wait_for(std::chrono::milliseconds timeout) const {
+  return job->result.wait_for(timeout) == std::future_status::ready;
+}
+
+inline const std::vector<std::vector<int>>& ApspJob::get() const {
+  return job->result.get();
+}
+
+inline std::shared_future<std::vector<std::vector<int>>> ApspJob::future() const {
+  return job->result;
+}
+
+
+inline ApspScheduler::ApspScheduler(int threads) {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([this] { work(); });
+  }
+}
+
+inline ApspScheduler::~ApspScheduler() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  ready.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  // the workers leave the queued jobs
+  for (auto& job : queue) {
+    job->cancel_requested = true;
+    job->finish(std::vector<std::vector<int>>());
+  }
+}
+
+// the job's snapshot is made before taking the lock, so the workers are
+// not held up by it
+inline ApspJob ApspScheduler::submit(const Graph<int>& g, const ApspJobOptions& options) {
+  return queue_job(std::make_shared<apsp_scheduler::Job>(GraphSnapshot(g), options));
+}
+
+inline ApspJob ApspScheduler::submit(const GraphSnapshot& g, const ApspJobOptions& options) {
+  return queue_job(std::make_shared<apsp_scheduler::Job>(g, options));
+}
+
+inline ApspJob ApspScheduler::queue_job(std::shared_ptr<apsp_scheduler::Job> job) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    job->sequence = next_sequence++;
+    queue.push_back(job);
+    std::push_heap(queue.begin(), queue.end(), apsp_scheduler::JobOrder());
+    pending++;
+  }
+  ready.notify_one();
+  return ApspJob(job);
+}
+
+inline int ApspScheduler::pending_count() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return pending;
+}
+
+inline int ApspScheduler::thread_count() const {
+  return workers.size();
+}
+
+inline ApspScheduler& ApspScheduler::shared() {
+  static ApspScheduler scheduler;
+  return scheduler;
+}
+
+inline void ApspScheduler::work() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    ready.wait(guard, [this] { return stopping || !queue.empty(); });
+    if (stopping) {
+      return;
+    }
+    // cancelled jobs leave the queue as soon as a worker is free, not
+    // when they reach the top
+    auto cancelled = std::partition(queue.begin(), queue.end(), [](const auto& job) { return !job->cancel_requested; });
+    if (cancelled != queue.end()) {
+      for (auto it = cancelled; it != queue.end(); it++) {
+        (*it)->finish(std::vector<std::vector<int>>());
+        pending--;
+      }
+      queue.erase(cancelled, queue.end());
+      std::make_heap(queue.begin(), queue.end(), apsp_scheduler::JobOrder());
+      if (queue.empty()) {
+        continue;
+      }
+    }
+    // a job is out of the queue while it runs, so only one worker at a
+    // time touches its state
+    std::pop_heap(queue.begin(), queue.end(), apsp_scheduler::JobOrder());
+    std::shared_ptr<apsp_scheduler::Job> job = queue.back();
+    queue.pop_back();
+    guard.unlock();
+
+    // an exception ends the job (and is rethrown by its get) rather
+    // than the worker
+    bool more = false;
+    std::exception_ptr error;
+    try {
+      more = !job->cancel_requested && job->step();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    // finished under the lock, so a job whose result is ready is never
+    // counted as pending
+    guard.lock();
+    if (more) {
+      queue.push_back(job);
+      std::push_heap(queue.begin(), queue.end(), apsp_scheduler::JobOrder());
+    } else if (error) {
+      pending--;
+      job->fail(error);
+    } else {
+      pending--;
+      job->finish(std::move(job->table));
+    }
+  }
+}
+
+
+#endif
@@ -0,0 +1,383 @@
+//----------------------------------------------------------------------
+// FILE: checkpoint.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Checkpoint and resume for long all-pairs runs. Floyd-Warshall
+//       saves the matrix and the number of finished pivots every few
+//       pivots (to a temporary file that is then renamed over the
+//       checkpoint, so a crash mid-write keeps the last one). Johnson's
+//       saves the potentials once and then appends the finished source
+//       rows. Each checkpoint records a fingerprint of the graph and is
+//       only resumed from for the same graph. Writes run on a
+//       background thread while the computation goes on.
+//
+//       Both files are raw host-order ints: a magic, the fingerprint
+//       (8 bytes) and n, then for Floyd-Warshall the finished pivots
+//       and the n x n matrix, and for Johnson's the n potentials and
+//       then complete n-entry rows in source order.
+//----------------------------------------------------------------------
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include "graph.h"
+#include "graph_algorithms.h"
+#include "algorithm_stats.h"
+
+
+//----------------------------------------------------------------------
+// Computes the shortest paths between all pairs of vertices using the
+// Floyd-Warshall algorithm (on a single n x n matrix), checkpointing
+// the matrix to the given file every interval pivots. If the file
+// holds a checkpoint for this graph, the run continues from it. The
+// final state is left in the file, so running again returns the
+// result from it; remove the file to start over.
+// Input:
+//  g -- the given directed weighted graph
+//  path -- the checkpoint file
+//  interval -- pivots between checkpoints (at least 1)
+//  stats -- optional counters to add this run's operation counts to
+//           (only updated when compiled with APSP_STATS)
+//  checkpoint_ok -- optional, set to false if a checkpoint couldn't be
+//                   written (no more are tried, but the run finishes)
+//                   and to true otherwise
+// Output: the same table as GraphAlgorithms::floyd_warshall (empty if
+//         the graph has a negative cycle)
+//----------------------------------------------------------------------
+inline std::vector<std::vector<int>> checkpointed_floyd_warshall(const Graph<int>& g, const std::string& path,
+                                                                 int interval = 64,
+                                                                 AlgorithmStats* stats = nullptr,
+                                                                 bool* checkpoint_ok = nullptr);
+
+//----------------------------------------------------------------------
+// Computes the shortest paths between all pairs of vertices using
+// Johnson's algorithm, appending each interval finished source rows
+// to the given file (after the potentials). If the file holds a
+// checkpoint for this graph, its potentials and rows are reused and
+// only the remaining sources are searched. The file is left complete
+// at the end; remove it to start over.
+// Input:
+//  g -- the given directed weighted graph
+//  path -- the checkpoint file
+//  interval -- rows between checkpoints (at least 1)
+//  stats -- optional counters to add this run's operation counts to
+//           (only updated when compiled with APSP_STATS)
+//  checkpoint_ok -- optional, set to false if a checkpoint couldn't be
+//                   written (no more are tried, but the run finishes)
+//                   and to true otherwise
+// Output: the same table as GraphAlgorithms::johnsons (empty if the
+//         graph has a negative cycle)
+//----------------------------------------------------------------------
+inline std::vector<std::vector<int>> checkpointed_johnsons(const Graph<int>& g, const std::string& path,
+                                                           int interval = 256, AlgorithmStats* stats = nullptr,
+                                                           bool* checkpoint_ok = nullptr);
+
+
+namespace checkpoint {
+
+// Returns a hash of the node count, directedness and edges of g (which
+// doesn't depend on the order the edges were added in)
+inline unsigned long long fingerprint(const Graph<int>& g) {
+  // FNV-1a over the bytes of each value
+  unsigned long long hash = 14695981039346656037ULL;
+  auto mix = [&hash](long long word) {
+    for (int b = 0; b < 8; b++) {
+      hash ^= (word >> (8 * b)) & 0xff;
+      hash *= 1099511628211ULL;
+    }
+  };
+  mix(g.node_count());
+  mix(g.is_directed());
+  for (int u = 0; u < g.node_count(); u++) {
+    std::vector<std::pair<int,int>> edges;
+    for (const auto& [label, v] : g.out_edges(u)) {
+      edges.emplace_back(v, label.value_or(0));
+    }
+    std::sort(edges.begin(), edges.end());
+    mix(edges.size());
+    for (const auto& [v, label] : edges) {
+      mix(v);
+      mix(label);
+    }
+  }
+  return hash;
+}
+
+// Writes a Floyd-Warshall checkpoint (the n x n row major matrix after
+// k pivots) to path, through a temporary file. Returns false if the
+// file couldn't be written.
+inline bool write_floyd_warshall(const std::string& path, unsigned long long hash, int n, int k,
+                                 const std::vector<int>& matrix) {
+  std::string temp = path + ".tmp";
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write("APFW", 4);
+    out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+    out.write(reinterpret_cast<const char*>(&n), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&k), sizeof(int));
+    out.write(reinterpret_cast<const char*>(matrix.data()), (long long) n * n * sizeof(int));
+    out.flush();
+    if (!out) {
+      std::remove(temp.c_str());
+      return false;
+    }
+  }
+  return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+// Reads a Floyd-Warshall checkpoint for a graph with the given hash
+// and node count. Returns false (leaving k and matrix alone) if there
+// is no such checkpoint.
+inline bool read_floyd_warshall(const std::string& path, unsigned long long hash, int n, int& k,
+                                std::vector<int>& matrix) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[4];
+  unsigned long long file_hash;
+  int file_n, file_k;
+  in.read(magic, 4);
+  in.read(reinterpret_cast<char*>(&file_hash), sizeof(file_hash));
+  in.read(reinterpret_cast<char*>(&file_n), sizeof(int));
+  in.read(reinterpret_cast<char*>(&file_k), sizeof(int));
+  if (!in || std::memcmp(magic, "APFW", 4) != 0 || file_hash != hash || file_n != n || file_k < 0
+      || file_k > n) {
+    return false;
+  }
+  std::vector<int> entries((long long) n * n);
+  in.read(reinterpret_cast<char*>(entries.data()), (long long) n * n * sizeof(int));
+  if (!in) {
+    return false;
+  }
+  k = file_k;
+  matrix.swap(entries);
+  return true;
+}
+
+// Starts a Johnson's checkpoint (the header and potentials) at path.
+// Returns false if the file couldn't be written.
+inline bool start_johnsons(const std::string& path, unsigned long long hash, const std::vector<int>& potentials) {
+  int n = potentials.size();
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write("APJN", 4);
+  out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+  out.write(reinterpret_cast<const char*>(&n), sizeof(int));
+  out.write(reinterpret_cast<const char*>(potentials.data()), n * sizeof(int));
+  out.flush();
+  return bool(out);
+}
+
+// Appends rows [first, last) to a Johnson's checkpoint. Returns false
+// if the file couldn't be written.
+inline bool append_johnsons(const std::string& path, const std::vector<std::vector<int>>& rows, int first,
+                            int last) {
+  std::ofstream out(path, std::ios::binary | std::ios::app);
+  for (int u = first; u < last; u++) {
+    out.write(reinterpret_cast<const char*>(rows[u].data()), rows[u].size() * sizeof(int));
+  }
+  out.flush();
+  return bool(out);
+}
+
+// Reads a Johnson's checkpoint for a graph with the given hash and
+// node count into potentials and the first rows of rows (which must
+// have n entries), dropping a partly written last row from the file.
+// Returns the number of rows read, or -1 (leaving both alone) if there
+// is no such checkpoint.
+inline int read_johnsons(const std::string& path, unsigned long long hash, int n, std::vector<int>& potentials,
+                         std::vector<std::vector<int>>& rows) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[4];
+  unsigned long long file_hash;
+  int file_n;
+  in.read(magic, 4);
+  in.read(reinterpret_cast<char*>(&file_hash), sizeof(file_hash));
+  in.read(reinterpret_cast<char*>(&file_n), sizeof(int));
+  if (!in || std::memcmp(magic, "APJN", 4) != 0 || file_hash != hash || file_n != n) {
+    return -1;
+  }
+  std::vector<int> h(n);
+  in.read(reinterpret_cast<char*>(h.data()), n * sizeof(int));
+  if (!in) {
+    return -1;
+  }
+  long long header = in.tellg();
+
+  int count = 0;
+  std::vector<int> row(n);
+  while (count < n && in.read(reinterpret_cast<char*>(row.data()), n * sizeof(int))) {
+    rows[count++] = row;
+  }
+  in.close();
+
+  // cut off a partial row so later rows are appended in place
+  std::error_code error;
+  std::filesystem::resize_file(path, header + (long long) count * n * sizeof(int), error);
+  if (error) {
+    return -1;
+  }
+  potentials.swap(h);
+  return count;
+}
+
+// one checkpoint write at a time on a background thread
+class AsyncWrite
+{
+public:
+  ~AsyncWrite() { wait(); }
+
+  // waits for the previous write, then starts write() on a new thread
+  template<typename F>
+  void start(F write) {
+    wait();
+    worker = std::thread([this, write] { ok = write() && ok; });
+  }
+
+  // waits for the current write (if any); returns false if any write
+  // has failed
+  bool wait() {
+    if (worker.joinable()) {
+      worker.join();
+    }
+    return ok;
+  }
+
+private:
+  std::thread worker;
+  bool ok = true;
+};
+
+}  // namespace checkpoint
+
+
+inline std::vector<std::vector<int>> checkpointed_floyd_warshall(const Graph<int>& g, const std::string& path,
+                                                                 int interval, AlgorithmStats* stats,
+                                                                 bool* checkpoint_ok) {
+  const int inf = std::numeric_limits<int>::max();
+  int n = g.node_count();
+  interval = std::max(1, interval);
+  unsigned long long hash = checkpoint::fingerprint(g);
+
+  std::vector<int> matrix;
+  int start = 0;
+  if (!checkpoint::read_floyd_warshall(path, hash, n, start, matrix)) {
+    start = 0;
+    matrix.assign((long long) n * n, inf);
+    for (int u = 0; u < n; u++) {
+      matrix[(long long) u * n + u] = 0;
+      for (const auto& [label, v] : g.out_edges(u)) {
+        if (v != u) {
+          matrix[(long long) u * n + v] = std::min(matrix[(long long) u * n + v], label.value());
+        } else {
+          matrix[(long long) u * n + u] = std::min(0, label.value());
+        }
+      }
+    }
+  }
+  // the matrix and the copy being written
+  std::vector<int> saved;
+  APSP_STAT(stats, bytes_allocated, 2LL * n * n * sizeof(int));
+
+  checkpoint::AsyncWrite writer;
+  for (int k = start; k < n; k++) {
+    APSP_STAT(stats, pivot_phases, 1);
+    const int* row_k = matrix.data() + (long long) k * n;
+    for (int i = 0; i < n; i++) {
+      int* row_i = matrix.data() + (long long) i * n;
+      int ik = row_i[k];
+      if (ik == inf) {
+        continue;
+      }
+      APSP_STAT(stats, relaxations, n);
+      for (int j = 0; j < n; j++) {
+        if (row_k[j] != inf && (long long) ik + row_k[j] < row_i[j]) {
+          row_i[j] = ik + row_k[j];
+          APSP_STAT(stats, successful_relaxations, 1);
+        }
+      }
+    }
+
+    // checkpoint a copy every interval pivots and at the end (until a
+    // write fails)
+    if (((k + 1) % interval == 0 || k + 1 == n) && writer.wait()) {
+      saved = matrix;
+      writer.start([&path, &saved, hash, n, k] {
+        return checkpoint::write_floyd_warshall(path, hash, n, k + 1, saved);
+      });
+    }
+  }
+  bool saving = writer.wait();
+  if (checkpoint_ok) {
+    *checkpoint_ok = saving;
+  }
+
+  std::vector<std::vector<int>> dists;
+  for (int u = 0; u < n; u++) {
+    if (matrix[(long long) u * n + u] < 0) {
+      return dists;  // negative cycle
+    }
+  }
+  for (int u = 0; u < n; u++) {
+    dists.emplace_back(matrix.begin() + (long long) u * n, matrix.begin() + (long long) (u + 1) * n);
+  }
+  return dists;
+}
+
+inline std::vector<std::vector<int>> checkpointed_johnsons(const Graph<int>& g, const std::string& path,
+                                                           int interval, AlgorithmStats* stats,
+                                                           bool* checkpoint_ok) {
+  int n = g.node_count();
+  interval = std::max(1, interval);
+  unsigned long long hash = checkpoint::fingerprint(g);
+
+  std::vector<std::vector<int>> dists(n);
+  std::vector<int> potentials;
+  bool saving = true;
+  if (checkpoint_ok) {
+    *checkpoint_ok = true;
+  }
+  int done = checkpoint::read_johnsons(path, hash, n, potentials, dists);
+  if (done < 0) {
+    done = 0;
+    potentials = GraphAlgorithms<int>::johnsons_prepare(g, stats);
+    if (potentials.size() != n) {
+      return std::vector<std::vector<int>>();  // negative cycle
+    }
+    saving = checkpoint::start_johnsons(path, hash, potentials);
+  }
+
+  // rows before done are never changed again, so the writer can read
+  // them while later rows are filled in. After a failed write no more
+  // rows are appended, since they would no longer line up in the file.
+  checkpoint::AsyncWrite writer;
+  int written = done;
+  for (int u = done; u < n; u++) {
+    dists[u] = GraphAlgorithms<int>::johnsons_query(g, potentials, u, stats);
+    if ((u + 1 - written) >= interval || u + 1 == n) {
+      saving = writer.wait() && saving;
+      if (saving) {
+        writer.start([&path, &dists, first = written, last = u + 1] {
+          return checkpoint::append_johnsons(path, dists, first, last);
+        });
+      }
+      written = u + 1;
+    }
+  }
+  saving = writer.wait() && saving;
+  if (checkpoint_ok) {
+    *checkpoint_ok = saving;
+  }
+
+  return dists;
+}
+
+
+#endif
@@ -0,0 +1,396 @@
+//----------------------------------------------------------------------
+// FILE: compressed_matrix.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Compressed storage for distance matrices (as returned by
+//       johnsons and floyd_warshall). Each row is a sequence of
+//       varint tokens: a finite entry is stored as the zigzag encoded
+//       difference from the previous finite entry of the row, and a
+//       run of "no path" (numeric_limits<int>::max()) entries as its
+//       length. Rows are found through an offset index, so any row can
+//       be decoded on its own. CompressedMatrixWriter streams the same
+//       format to an output stream one row at a time.
+//
+//       Stream format: the magic "APSM", the column count (varint),
+//       then for each row its encoded size plus one (varint) and its
+//       bytes, ending with a 0 and the row count (varint).
+//----------------------------------------------------------------------
+
+
+#ifndef COMPRESSED_MATRIX_H
+#define COMPRESSED_MATRIX_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+
+namespace compressed_matrix {
+
+const int inf = std::numeric_limits<int>::max();
+
+// appends x as a little endian base 128 varint
+inline void put_varint(std::vector<uint8_t>& out, uint64_t x) {
+  while (x >= 0x80) {
+    out.push_back((x & 0x7f) | 0x80);
+    x >>= 7;
+  }
+  out.push_back(x);
+}
+
+// reads a varint at pos (advancing it), or returns false if the bytes
+// end first or the value is too long
+inline bool get_varint(const uint8_t* data, size_t size, size_t& pos, uint64_t& x) {
+  x = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= size) {
+      return false;
+    }
+    uint8_t byte = data[pos++];
+    x |= (uint64_t) (byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// reads a varint from a stream
+inline bool get_varint(std::istream& in, uint64_t& x) {
+  x = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = in.get();
+    if (byte == std::char_traits<char>::eof()) {
+      return false;
+    }
+    x |= (uint64_t) (byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// appends the tokens for the first cols entries of row
+inline void encode_row(const int* row, int cols, std::vector<uint8_t>& out) {
+  long long previous = 0;
+  int j = 0;
+  while (j < cols) {
+    if (row[j] == inf) {
+      int run = 1;
+      while (j + run < cols && row[j + run] == inf) {
+        run++;
+      }
+      put_varint(out, ((uint64_t) (run - 1) << 1) | 1);
+      j += run;
+    } else {
+      long long delta = row[j] - previous;
+      uint64_t zigzag = ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+      put_varint(out, zigzag << 1);
+      previous = row[j];
+      j++;
+    }
+  }
+}
+
+// decodes a row of cols entries from the given bytes into row (or only
+// checks them if row is null), or returns false if they are malformed
+inline bool decode_row(const uint8_t* data, size_t size, int cols, int* row) {
+  long long previous = 0;
+  size_t pos = 0;
+  int j = 0;
+  while (j < cols) {
+    uint64_t token;
+    if (!get_varint(data, size, pos, token)) {
+      return false;
+    }
+    if (token & 1) {
+      uint64_t run = (token >> 1) + 1;
+      if (run > (uint64_t) (cols - j)) {
+        return false;
+      }
+      if (row) {
+        std::fill(row + j, row + j + run, inf);
+      }
+      j += run;
+    } else {
+      uint64_t zigzag = token >> 1;
+      long long delta = (long long) (zigzag >> 1) ^ -(long long) (zigzag & 1);
+      previous += delta;
+      if (previous < std::numeric_limits<int>::min() || previous >= inf) {
+        return false;
+      }
+      if (row) {
+        row[j] = previous;
+      }
+      j++;
+    }
+  }
+  return pos == size;
+}
+
+}  // namespace compressed_matrix
+
+
+class CompressedMatrix
+{
+public:
+
+  // constructor for an empty (0 x 0) matrix
+  CompressedMatrix();
+
+  // constructor that compresses the given matrix (every row is assumed
+  // to have the length of the first)
+  CompressedMatrix(const std::vector<std::vector<int>>& matrix);
+
+  // Appends a row of cols() entries (the first row sets cols())
+  void append_row(const std::vector<int>& row);
+
+  // Returns the number of rows
+  int rows() const;
+
+  // Returns the number of columns
+  int cols() const;
+
+  // Returns row i decoded, or an empty vector if i is out of range
+  std::vector<int> row(int i) const;
+
+  // Decodes row i into out (resized to cols()), reusing its storage.
+  // Returns false if i is out of range.
+  bool row(int i, std::vector<int>& out) const;
+
+  // Returns the whole matrix decoded
+  std::vector<std::vector<int>> decompress() const;
+
+  // Returns the bytes used by the encoded rows and the row index
+  size_t byte_size() const;
+
+  // Writes the matrix in the stream format. Returns false if the
+  // stream failed.
+  bool write(std::ostream& out) const;
+
+  // Replaces the matrix with one read in the stream format. Returns
+  // false (and leaves the matrix empty) if the data is malformed.
+  bool read(std::istream& in);
+
+private:
+  int columns = 0;
+  std::vector<uint8_t> data;
+  std::vector<size_t> offsets;  // row i is [offsets[i], offsets[i+1])
+};
+
+
+class CompressedMatrixWriter
+{
+public:
+
+  // Constructor that starts a matrix with the given number of columns
+  // on out (which must outlive the writer)
+  CompressedMatrixWriter(std::ostream& out, int cols);
+
+  // Encodes and writes one row of cols entries. Returns false if the
+  // row has the wrong length or the stream failed.
+  bool write_row(const std::vector<int>& row);
+
+  // Ends the matrix. No more rows can be written. Returns false if the
+  // stream failed.
+  bool finish();
+
+  // Returns the number of rows written
+  int rows() const;
+
+  // Returns the number of bytes written so far
+  size_t bytes_written() const;
+
+private:
+  std::ostream& out;
+  int columns;
+  int row_count = 0;
+  size_t written = 0;
+  bool finished = false;
+  std::vector<uint8_t> buffer;  // reused row encoding buffer
+
+  // writes the buffer and clears it
+  void flush();
+};
+
+
+inline CompressedMatrix::CompressedMatrix() : offsets(1, 0) {
+}
+
+inline CompressedMatrix::CompressedMatrix(const std::vector<std::vector<int>>& matrix) : offsets(1, 0) {
+  for (const auto& r : matrix) {
+    append_row(r);
+  }
+}
+
+inline void CompressedMatrix::append_row(const std::vector<int>& row) {
+  if (offsets.size() == 1) {
+    columns = row.size();
+  }
+  std::vector<int> padded;
+  const int* entries = row.data();
+  if ((int) row.size() < columns) {
+    padded = row;
+    padded.resize(columns, compressed_matrix::inf);
+    entries = padded.data();
+  }
+  compressed_matrix::encode_row(entries, columns, data);
+  offsets.push_back(data.size());
+}
+
+inline int CompressedMatrix::rows() const {
+  return offsets.size() - 1;
+}
+
+inline int CompressedMatrix::cols() const {
+  return columns;
+}
+
+inline std::vector<int> CompressedMatrix::row(int i) const {
+  std::vector<int> out;
+  row(i, out);
+  return out;
+}
+
+inline bool CompressedMatrix::row(int i, std::vector<int>& out) const {
+  if (i < 0 || i >= rows()) {
+    out.clear();
+    return false;
+  }
+  out.resize(columns);
+  return compressed_matrix::decode_row(data.data() + offsets[i], offsets[i + 1] - offsets[i], columns,
+                                       out.data());
+}
+
+inline std::vector<std::vector<int>> CompressedMatrix::decompress() const {
+  std::vector<std::vector<int>> matrix(rows());
+  for (int i = 0; i < rows(); i++) {
+    row(i, matrix[i]);
+  }
+  return matrix;
+}
+
+inline size_t CompressedMatrix::byte_size() const {
+  return data.size() + offsets.size() * sizeof(size_t);
+}
+
+inline bool CompressedMatrix::write(std::ostream& out) const {
+  CompressedMatrixWriter writer(out, columns);
+  std::vector<int> r;
+  for (int i = 0; i < rows(); i++) {
+    row(i, r);
+    writer.write_row(r);
+  }
+  return writer.finish();
+}
+
+inline bool CompressedMatrix::read(std::istream& in) {
+  *this = CompressedMatrix();
+  char magic[4];
+  uint64_t cols;
+  in.read(magic, 4);
+  if (!in || std::string(magic, 4) != "APSM" || !compressed_matrix::get_varint(in, cols)
+      || cols > (uint64_t) std::numeric_limits<int>::max()) {
+    return false;
+  }
+
+  // nothing is sized from the header: rows are read in chunks as their
+  // bytes arrive and only checked (not decoded), so a corrupt count
+  // fails at the end of the stream instead of allocating for it
+  const uint64_t chunk = 1 << 16;
+  CompressedMatrix result;
+  result.columns = cols;
+  while (true) {
+    uint64_t size;
+    if (!compressed_matrix::get_varint(in, size)) {
+      return false;
+    }
+    if (size == 0) {
+      break;
+    }
+    // a token is at most 5 bytes and covers at least one entry
+    size--;
+    if (size > 10 * cols) {
+      return false;
+    }
+    size_t start = result.data.size();
+    for (uint64_t done = 0; done < size; done += chunk) {
+      uint64_t part = std::min(chunk, size - done);
+      result.data.resize(start + done + part);
+      in.read(reinterpret_cast<char*>(result.data.data() + start + done), part);
+      if (!in) {
+        return false;
+      }
+    }
+    if (!compressed_matrix::decode_row(result.data.data() + start, size, cols, nullptr)) {
+      return false;
+    }
+    result.offsets.push_back(result.data.size());
+  }
+  uint64_t count;
+  if (!compressed_matrix::get_varint(in, count) || count != (uint64_t) result.rows()) {
+    return false;
+  }
+
+  *this = std::move(result);
+  return true;
+}
+
+
+inline CompressedMatrixWriter::CompressedMatrixWriter(std::ostream& out, int cols)
+  : out(out), columns(cols) {
+  out.write("APSM", 4);
+  written = 4;
+  compressed_matrix::put_varint(buffer, cols);
+  flush();
+}
+
+inline bool CompressedMatrixWriter::write_row(const std::vector<int>& row) {
+  if (finished || (int) row.size() != columns) {
+    return false;
+  }
+  // the size prefix goes after the encoded row in the buffer, so write
+  // it first and then the row
+  compressed_matrix::encode_row(row.data(), columns, buffer);
+  size_t encoded = buffer.size();
+  compressed_matrix::put_varint(buffer, encoded + 1);
+  out.write(reinterpret_cast<const char*>(buffer.data() + encoded), buffer.size() - encoded);
+  written += buffer.size() - encoded;
+  buffer.resize(encoded);
+  flush();
+  row_count++;
+  return bool(out);
+}
+
+inline bool CompressedMatrixWriter::finish() {
+  if (!finished) {
+    compressed_matrix::put_varint(buffer, 0);
+    compressed_matrix::put_varint(buffer, row_count);
+    flush();
+    out.flush();
+    finished = true;
+  }
+  return bool(out);
+}
+
+inline int CompressedMatrixWriter::rows() const {
+  return row_count;
+}
+
+inline size_t CompressedMatrixWriter::bytes_written() const {
+  return written;
+}
+
+inline void CompressedMatrixWriter::flush() {
+  out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  written += buffer.size();
+  buffer.clear();
+}
+
+
+#endif
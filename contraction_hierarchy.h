@@ -0,0 +1,392 @@
+//----------------------------------------------------------------------
+// FILE: contraction_hierarchy.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Contraction hierarchy index for fast point-to-point shortest
+//       path queries. Nodes are contracted one at a time in order of
+//       (lazily updated) edge difference, adding shortcut edges where
+//       a local witness search can't find another path as short as
+//       the one through the contracted node. A query is a
+//       bidirectional dijkstra that only follows edges upward in the
+//       contraction order. Assumes non-negative edge labels.
+//----------------------------------------------------------------------
+
+
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <functional>
+#include <algorithm>
+#include "graph.h"
+#include "static_graph.h"
+
+
+class ContractionHierarchy
+{
+public:
+
+  // Constructor that builds the hierarchy for g. Witness searches stop
+  // after settling witness_limit nodes (adding the shortcut), trading
+  // a few unnecessary shortcuts for faster preprocessing.
+  ContractionHierarchy(const Graph<int>& g, int witness_limit = 500);
+
+  // Returns the shortest path cost from s to t, or
+  // numeric_limits<int>::max() if t is unreachable from s. Uses
+  // internal search buffers, so a single index shouldn't be queried
+  // from more than one thread at a time.
+  int distance(int s, int t) const;
+
+  // Returns the position of x in the contraction order
+  int rank(int x) const;
+
+  // Returns the number of shortcut edges added during preprocessing
+  long long shortcut_count() const;
+
+  // Returns the total number of nodes in the graph.
+  int node_count() const;
+
+private:
+  // an edge to node with the given weight
+  struct Edge
+  {
+    int node;
+    long long weight;
+  };
+
+  typedef std::pair<long long,int> Entry;  // (distance, node)
+  typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> MinHeap;
+
+  static constexpr long long inf = std::numeric_limits<long long>::max();
+
+  int nodes;
+  int next_rank = 0;
+  long long shortcuts = 0;
+  std::vector<int> order_rank;
+
+  // upward graph: forward arcs (x -> higher ranked y) and backward arcs
+  // (higher ranked y -> x, stored at x) in CSR form
+  std::vector<int> up_offsets;
+  std::vector<Edge> up_list;
+  std::vector<int> down_offsets;
+  std::vector<Edge> down_list;
+
+  // query buffers (reset through the touched lists)
+  mutable std::vector<long long> forward_dist;
+  mutable std::vector<long long> backward_dist;
+  mutable std::vector<int> touched;
+
+  // preprocessing state
+  std::vector<std::vector<Edge>> out;
+  std::vector<std::vector<Edge>> in;
+  std::vector<bool> contracted;
+  std::vector<int> deleted_neighbors;
+  std::vector<long long> witness_dist;
+  std::vector<int> witness_touched;
+  std::vector<Entry> witness_heap;
+  std::vector<bool> witness_target;
+  int max_settled;
+
+  // settle limit for the witness searches that only estimate a
+  // node's priority (smaller than max_settled, since every
+  // contraction re-checks all of the contracted node's neighbors)
+  static constexpr int priority_settled = 10;
+
+  // lowers (or adds) the edge to node in edges
+  static void add_or_lower(std::vector<Edge>& edges, int node, long long weight);
+
+  // removes the edge to node from edges
+  static void remove_edge(std::vector<Edge>& edges, int node);
+
+  // Counts (and if add is true, inserts) the shortcuts needed to
+  // contract x, settling at most settle_limit nodes per witness search
+  int shortcuts_for(int x, bool add, int settle_limit);
+
+  // Returns the contraction priority of x (edge difference plus the
+  // number of already contracted neighbors)
+  int priority(int x);
+
+  // contracts x as the next node in the order
+  void contract(int x, std::vector<std::vector<Edge>>& up, std::vector<std::vector<Edge>>& down);
+};
+
+
+inline ContractionHierarchy::ContractionHierarchy(const Graph<int>& g, int witness_limit)
+  : nodes(g.node_count()), order_rank(g.node_count(), -1), out(g.node_count()), in(g.node_count()),
+    contracted(g.node_count(), false), deleted_neighbors(g.node_count(), 0),
+    witness_dist(g.node_count(), std::numeric_limits<long long>::max()),
+    witness_target(g.node_count(), false), max_settled(witness_limit) {
+  // working copy of the graph (no self loops, parallel edges merged)
+  StaticGraph sg(g);
+  for (int x = 0; x < nodes; x++) {
+    for (const auto& arc : sg.out_arcs(x)) {
+      if (arc.node != x) {
+        add_or_lower(out[x], arc.node, arc.label);
+        add_or_lower(in[arc.node], x, arc.label);
+      }
+    }
+  }
+
+  // contract in order of (lazily re-checked) priority
+  std::vector<std::vector<Edge>> up(nodes), down(nodes);
+  std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<std::pair<int,int>>> queue;
+  for (int x = 0; x < nodes; x++) {
+    queue.push(std::make_pair(priority(x), x));
+  }
+  while (!queue.empty()) {
+    auto [p, x] = queue.top();
+    queue.pop();
+    if (contracted[x]) {
+      continue;
+    }
+    int current = priority(x);
+    if (!queue.empty() && current > queue.top().first) {
+      queue.push(std::make_pair(current, x));
+      continue;
+    }
+    std::vector<int> neighbors;
+    for (const Edge& e : out[x]) {
+      neighbors.push_back(e.node);
+    }
+    for (const Edge& e : in[x]) {
+      neighbors.push_back(e.node);
+    }
+    contract(x, up, down);
+    // neighbors' priorities changed, so queue them with fresh values
+    for (int y : neighbors) {
+      if (!contracted[y]) {
+        queue.push(std::make_pair(priority(y), y));
+      }
+    }
+  }
+
+  // flatten the upward graph
+  up_offsets.assign(nodes + 1, 0);
+  down_offsets.assign(nodes + 1, 0);
+  for (int x = 0; x < nodes; x++) {
+    up_list.insert(up_list.end(), up[x].begin(), up[x].end());
+    up_offsets[x + 1] = up_list.size();
+    down_list.insert(down_list.end(), down[x].begin(), down[x].end());
+    down_offsets[x + 1] = down_list.size();
+  }
+
+  // release preprocessing state
+  out = std::vector<std::vector<Edge>>();
+  in = std::vector<std::vector<Edge>>();
+  witness_dist = std::vector<long long>();
+  witness_target = std::vector<bool>();
+  forward_dist.assign(nodes, inf);
+  backward_dist.assign(nodes, inf);
+}
+
+inline void ContractionHierarchy::add_or_lower(std::vector<Edge>& edges, int node, long long weight) {
+  for (Edge& e : edges) {
+    if (e.node == node) {
+      if (weight < e.weight) {
+        e.weight = weight;
+      }
+      return;
+    }
+  }
+  edges.push_back(Edge{node, weight});
+}
+
+inline void ContractionHierarchy::remove_edge(std::vector<Edge>& edges, int node) {
+  for (size_t i = 0; i < edges.size(); i++) {
+    if (edges[i].node == node) {
+      edges[i] = edges.back();
+      edges.pop_back();
+      return;
+    }
+  }
+}
+
+inline int ContractionHierarchy::shortcuts_for(int x, bool add, int settle_limit) {
+  int count = 0;
+  for (const Edge& in_edge : in[x]) {
+    int u = in_edge.node;
+
+    // longest path through x that a witness needs to beat, and the
+    // targets the search can stop after settling
+    long long limit = 0;
+    int targets = 0;
+    for (const Edge& out_edge : out[x]) {
+      if (out_edge.node != u) {
+        limit = std::max(limit, in_edge.weight + out_edge.weight);
+        witness_target[out_edge.node] = true;
+        targets++;
+      }
+    }
+    if (targets == 0) {
+      continue;
+    }
+
+    // bounded dijkstra from u that avoids x
+    // (the heap's storage is reused across searches)
+    witness_heap.clear();
+    auto heap_order = std::greater<Entry>();
+    witness_dist[u] = 0;
+    witness_touched.push_back(u);
+    witness_heap.push_back(Entry(0, u));
+    int settled = 0;
+    while (!witness_heap.empty() && settled < settle_limit) {
+      std::pop_heap(witness_heap.begin(), witness_heap.end(), heap_order);
+      auto [d, y] = witness_heap.back();
+      witness_heap.pop_back();
+      if (d > witness_dist[y]) {
+        continue;
+      }
+      if (d > limit) {
+        break;
+      }
+      settled++;
+      if (witness_target[y] && --targets == 0) {
+        break;
+      }
+      for (const Edge& e : out[y]) {
+        if (e.node == x || d + e.weight >= witness_dist[e.node]) {
+          continue;
+        }
+        if (witness_dist[e.node] == inf) {
+          witness_touched.push_back(e.node);
+        }
+        witness_dist[e.node] = d + e.weight;
+        witness_heap.push_back(Entry(witness_dist[e.node], e.node));
+        std::push_heap(witness_heap.begin(), witness_heap.end(), heap_order);
+      }
+    }
+
+    // shortcut u -> w wherever no witness was found
+    for (const Edge& out_edge : out[x]) {
+      int w = out_edge.node;
+      long long through_x = in_edge.weight + out_edge.weight;
+      if (w == u) {
+        continue;
+      }
+      witness_target[w] = false;
+      if (witness_dist[w] <= through_x) {
+        continue;
+      }
+      count++;
+      if (add) {
+        add_or_lower(out[u], w, through_x);
+        add_or_lower(in[w], u, through_x);
+      }
+    }
+
+    for (int y : witness_touched) {
+      witness_dist[y] = inf;
+    }
+    witness_touched.clear();
+  }
+  return count;
+}
+
+inline int ContractionHierarchy::priority(int x) {
+  int removed = in[x].size() + out[x].size();
+  return shortcuts_for(x, false, priority_settled) - removed + deleted_neighbors[x];
+}
+
+inline void ContractionHierarchy::contract(int x, std::vector<std::vector<Edge>>& up,
+                                           std::vector<std::vector<Edge>>& down) {
+  order_rank[x] = next_rank++;
+
+  // every remaining neighbor is ranked higher than x
+  up[x] = out[x];
+  down[x] = in[x];
+
+  shortcuts += shortcuts_for(x, true, max_settled);
+
+  // remove x from the remaining graph
+  for (const Edge& e : out[x]) {
+    remove_edge(in[e.node], x);
+    deleted_neighbors[e.node]++;
+  }
+  for (const Edge& e : in[x]) {
+    remove_edge(out[e.node], x);
+    deleted_neighbors[e.node]++;
+  }
+  out[x].clear();
+  out[x].shrink_to_fit();
+  in[x].clear();
+  in[x].shrink_to_fit();
+  contracted[x] = true;
+}
+
+inline int ContractionHierarchy::distance(int s, int t) const {
+  if (s < 0 || s >= nodes || t < 0 || t >= nodes) {
+    return std::numeric_limits<int>::max();
+  }
+  if (s == t) {
+    return 0;
+  }
+
+  MinHeap forward, backward;
+  forward_dist[s] = 0;
+  backward_dist[t] = 0;
+  touched.push_back(s);
+  touched.push_back(t);
+  forward.push(Entry(0, s));
+  backward.push(Entry(0, t));
+  long long best = inf;
+
+  while (!forward.empty() || !backward.empty()) {
+    long long forward_min = forward.empty() ? inf : forward.top().first;
+    long long backward_min = backward.empty() ? inf : backward.top().first;
+    if (std::min(forward_min, backward_min) >= best) {
+      break;
+    }
+
+    // expand the side with the smaller tentative distance
+    bool is_forward = forward_min <= backward_min;
+    MinHeap& heap = is_forward ? forward : backward;
+    std::vector<long long>& dist = is_forward ? forward_dist : backward_dist;
+    std::vector<long long>& other = is_forward ? backward_dist : forward_dist;
+    const std::vector<int>& offsets = is_forward ? up_offsets : down_offsets;
+    const std::vector<Edge>& edges = is_forward ? up_list : down_list;
+
+    auto [d, x] = heap.top();
+    heap.pop();
+    if (d > dist[x]) {
+      continue;
+    }
+    if (other[x] != inf && d + other[x] < best) {
+      best = d + other[x];
+    }
+    for (int i = offsets[x]; i < offsets[x + 1]; i++) {
+      const Edge& e = edges[i];
+      if (d + e.weight < dist[e.node]) {
+        if (forward_dist[e.node] == inf && backward_dist[e.node] == inf) {
+          touched.push_back(e.node);
+        }
+        dist[e.node] = d + e.weight;
+        heap.push(Entry(dist[e.node], e.node));
+      }
+    }
+  }
+
+  for (int x : touched) {
+    forward_dist[x] = inf;
+    backward_dist[x] = inf;
+  }
+  touched.clear();
+
+  return best == inf ? std::numeric_limits<int>::max() : best;
+}
+
+inline int ContractionHierarchy::rank(int x) const {
+  return order_rank[x];
+}
+
+inline long long ContractionHierarchy::shortcut_count() const {
+  return shortcuts;
+}
+
+inline int ContractionHierarchy::node_count() const {
+  return nodes;
+}
+
+
+#endif
@@ -0,0 +1,936 @@
+//---------------------------------------------------------------------------
+// NAME: Zach Sahlin
+// FILE: final_bench.cpp
+// DATE: Fall 2022
+// DESC: Google Benchmark suite for the graph generators in util.cpp and
+//       the shortest path engines in graph_algorithms.h. To run from
+//       the command line use:
+//          ./final_bench
+//       which runs every benchmark with repetitions and writes the
+//       results (including mean, median, stddev and cv aggregates) to
+//       final_bench.json. Any of the standard --benchmark_* flags can
+//       be given to override these defaults, e.g.:
+//          ./final_bench --benchmark_filter=johnsons --benchmark_repetitions=10
+//---------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <benchmark/benchmark.h>
+#include "util.h"
+#include "adjacency_list.h"
+#include "graph_builder.h"
+#include "graph_algorithms.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
+#include "alt_search.h"
+#include "process_floyd_warshall.h"
+#include "compressed_matrix.h"
+#include "checkpoint.h"
+#include "vertex_order.h"
+#include "snapshot_graph.h"
+#include "apsp_scheduler.h"
+#include "small_graph_batch.h"
+
+using namespace std;
+
+
+// benchmark parameters
+const int repetitions = 5;
+const double dense_pct = 0.1;
+
+// size sweeps (node counts). The sparse generators are O(n) and go
+// well into the tens of thousands. The dense generators add O(n^2)
+// edges. The engine sweeps are capped where each engine becomes
+// impractical: floyd_warshall keeps its (n+1) x n x n table on the
+// stack and johnsons runs n dijkstra passes.
+const int sparse_gen_max = 1 << 15;
+const int synthetic_gen_max = 1 << 20;
+const int load_max = 1 << 16;
+const int dense_gen_max = 1 << 12;
+const int sssp_max = 1 << 12;
+const int johnsons_max = 1 << 10;
+const int floyd_warshall_max = 1 << 6;
+const int process_floyd_warshall_max = 1 << 10;
+const int point_to_point_max = 1 << 14;
+
+
+//----------------------------------------------------------------------
+// Helpers
+//----------------------------------------------------------------------
+
+// the input shapes used for the engine benchmarks
+enum Shape { SPARSE = 0, DENSE = 1 };
+
+void load_shape(Graph<int>& g, int shape)
+{
+  if (shape == SPARSE)
+    load_sparse(g);
+  else
+    load_dense(g, dense_pct);
+}
+
+void set_graph_counters(benchmark::State& state, const Graph<int>& g)
+{
+  state.counters["nodes"] = g.node_count();
+  state.counters["edges"] = g.edge_count();
+}
+
+// times a generator on a fresh, empty graph each iteration
+template<typename Loader>
+void run_generator(benchmark::State& state, Loader load)
+{
+  int n = state.range(0);
+  int edges = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    AdjacencyList<int>* g = new AdjacencyList<int>(n, true);
+    state.ResumeTiming();
+    load(*g);
+    state.PauseTiming();
+    edges = g->edge_count();
+    delete g;
+    state.ResumeTiming();
+  }
+  state.counters["nodes"] = n;
+  state.counters["edges"] = edges;
+  state.SetItemsProcessed(state.iterations() * edges);
+}
+
+
+//----------------------------------------------------------------------
+// Generators
+//----------------------------------------------------------------------
+
+void BM_load_sparse(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) { load_sparse(g); });
+}
+
+void BM_load_sparse_region(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) {
+    load_sparse(g, 0, g.node_count() / 2);
+    load_sparse(g, g.node_count() / 2, g.node_count() - 1);
+  });
+}
+
+void BM_load_sparse_acyclic_bipartite(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) { load_sparse_acyclic_bipartite(g); });
+}
+
+void BM_load_sparse_mini_cycles(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) { load_sparse_mini_cycles(g); });
+}
+
+void BM_load_dense(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) { load_dense(g, dense_pct); });
+}
+
+void BM_load_dense_region(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) {
+    load_dense(g, dense_pct, 0, g.node_count() / 2);
+    load_dense(g, dense_pct, g.node_count() / 2, g.node_count());
+  });
+}
+
+void BM_load_dense_cyclic(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) { load_dense_cyclic(g, dense_pct); });
+}
+
+void BM_load_dense_mini_cycles(benchmark::State& state)
+{
+  run_generator(state, [](Graph<int>& g) { load_dense_mini_cycles(g, dense_pct); });
+}
+
+BENCHMARK(BM_load_sparse)->RangeMultiplier(4)->Range(64, sparse_gen_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_sparse_region)->RangeMultiplier(4)->Range(64, sparse_gen_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_sparse_acyclic_bipartite)->RangeMultiplier(4)->Range(64, sparse_gen_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_sparse_mini_cycles)->RangeMultiplier(4)->Range(64, sparse_gen_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_dense)->RangeMultiplier(4)->Range(64, dense_gen_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_dense_region)->RangeMultiplier(4)->Range(64, dense_gen_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_dense_cyclic)->RangeMultiplier(4)->Range(64, dense_gen_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_dense_mini_cycles)->RangeMultiplier(4)->Range(64, dense_gen_max)->Unit(benchmark::kMillisecond);
+
+// the synthetic generators only produce edge lists (no graph), with
+// arg 0 = node count and arg 1 = negative labels
+void set_edge_counters(benchmark::State& state, int n, size_t edges)
+{
+  state.counters["nodes"] = n;
+  state.counters["edges"] = edges;
+  state.SetItemsProcessed(state.iterations() * edges);
+}
+
+void BM_generate_rmat(benchmark::State& state)
+{
+  int n = state.range(0);
+  size_t edges = 0;
+  for (auto _ : state) {
+    auto result = generate_rmat(n, 8LL * n, 1, state.range(1));
+    edges = result.size();
+  }
+  set_edge_counters(state, n, edges);
+}
+
+void BM_generate_grid(benchmark::State& state)
+{
+  int side = 1;
+  while (side * side < state.range(0))
+    ++side;
+  size_t edges = 0;
+  for (auto _ : state) {
+    auto result = generate_grid(side, side, 1, state.range(1));
+    edges = result.size();
+  }
+  set_edge_counters(state, side * side, edges);
+}
+
+void BM_generate_geometric(benchmark::State& state)
+{
+  // radius chosen for an average of about 8 neighbors per node
+  int n = state.range(0);
+  double radius = sqrt(8.0 / (3.14159 * n));
+  size_t edges = 0;
+  for (auto _ : state) {
+    auto result = generate_geometric(n, radius, 1, state.range(1));
+    edges = result.size();
+  }
+  set_edge_counters(state, n, edges);
+}
+
+BENCHMARK(BM_generate_rmat)->ArgNames({"n", "negative"})->RangeMultiplier(8)
+  ->Ranges({{1 << 10, synthetic_gen_max}, {0, 1}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_generate_grid)->ArgNames({"n", "negative"})->RangeMultiplier(8)
+  ->Ranges({{1 << 10, synthetic_gen_max}, {0, 1}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_generate_geometric)->ArgNames({"n", "negative"})->RangeMultiplier(8)
+  ->Ranges({{1 << 10, synthetic_gen_max}, {0, 1}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// loading an r-mat edge list (8 edges per node) edge by edge versus
+// with the bulk builder
+void BM_load_edges_rmat(benchmark::State& state)
+{
+  int n = state.range(0);
+  auto edges = generate_rmat(n, 8LL * n, 1);
+  run_generator(state, [&](Graph<int>& g) { load_edges(g, edges); });
+}
+
+void BM_graph_builder_rmat(benchmark::State& state)
+{
+  int n = state.range(0);
+  auto edges = generate_rmat(n, 8LL * n, 1);
+  int count = 0;
+  for (auto _ : state) {
+    GraphBuilder<int> builder(n, true);
+    builder.add_edges(edges);
+    AdjacencyList<int> g = builder.build(0);
+    count = g.edge_count();
+  }
+  state.counters["nodes"] = n;
+  state.counters["edges"] = count;
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+// same as above, with the edges allocated from a node pool (includes
+// tearing the graph down)
+void BM_graph_builder_pooled_rmat(benchmark::State& state)
+{
+  int n = state.range(0);
+  auto edges = generate_rmat(n, 8LL * n, 1);
+  int count = 0;
+  for (auto _ : state) {
+    GraphBuilder<int> builder(n, true);
+    builder.add_edges(edges);
+    PooledAdjacencyList<int> g = builder.build(0, PoolAllocator<pair<optional<int>,int>>());
+    count = g.edge_count();
+  }
+  state.counters["nodes"] = n;
+  state.counters["edges"] = count;
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(BM_load_edges_rmat)->RangeMultiplier(4)->Range(1 << 10, load_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_graph_builder_rmat)->RangeMultiplier(4)->Range(1 << 10, load_max)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_graph_builder_pooled_rmat)->RangeMultiplier(4)->Range(1 << 10, load_max)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+//----------------------------------------------------------------------
+// Engines (arg 0 = node count, arg 1 = input shape)
+//----------------------------------------------------------------------
+
+void BM_johnsons(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  for (auto _ : state) {
+    auto dists = GraphAlgorithms<int>::johnsons(g);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+// sums each row as it is produced instead of keeping the table
+void BM_johnsons_stream(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  for (auto _ : state) {
+    long long total = 0;
+    GraphAlgorithms<int>::johnsons_stream(g, [&](int, const vector<int>& row) {
+      for (int d : row)
+        if (d != numeric_limits<int>::max())
+          total += d;
+    });
+    benchmark::DoNotOptimize(total);
+  }
+  set_graph_counters(state, g);
+}
+
+// the sparse shape is one big component, the dense shape is acyclic
+void BM_condensed_apsp(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  for (auto _ : state) {
+    auto dists = GraphAlgorithms<int>::condensed_apsp(g);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+// 64 node sparse and dense regions in a ring, joined by one edge each
+// way between neighboring regions
+void load_blocks(Graph<int>& g)
+{
+  int n = g.node_count();
+  for (int start = 0; start + 64 <= n; start += 64) {
+    if (start / 64 % 2 == 0)
+      load_sparse(g, start, start + 63);
+    else
+      load_dense(g, dense_pct, start, start + 64);
+    int next = (start + 64) % n;
+    g.add_edge(start + 63, 5, next);
+    g.add_edge(next + 1, 5, start + 1);
+  }
+}
+
+// arg 1 = 0 for johnsons, 1 for the automatic partition, 2 for the
+// partition into the generated regions
+void BM_partitioned_apsp(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_blocks(g);
+  vector<int> regions;
+  for (int x = 0; x < g.node_count(); x++)
+    regions.push_back(x / 64);
+  for (auto _ : state) {
+    vector<vector<int>> dists;
+    if (state.range(1) == 0)
+      dists = GraphAlgorithms<int>::johnsons(g);
+    else
+      dists = GraphAlgorithms<int>::partitioned_apsp(g, state.range(1) == 2 ? regions : vector<int>());
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+// n/16 sources to n/4 targets (compare with BM_johnsons)
+void BM_many_to_many(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  vector<int> sources, targets;
+  for (int x = 0; x < g.node_count(); x += 16)
+    sources.push_back(x);
+  for (int x = 1; x < g.node_count(); x += 4)
+    targets.push_back(x);
+  for (auto _ : state) {
+    auto table = GraphAlgorithms<int>::many_to_many(g, sources, targets);
+    benchmark::DoNotOptimize(table.data());
+  }
+  set_graph_counters(state, g);
+}
+
+// undirected square grid with about n nodes. arg 1 = 0 for johnsons,
+// 1 for symmetric_apsp, 2 for a single process (full matrix) blocked
+// floyd warshall, 3 for symmetric_floyd_warshall
+void BM_symmetric_apsp(benchmark::State& state)
+{
+  int side = sqrt(state.range(0));
+  AdjacencyList<int> g(side * side, false);
+  load_edges(g, generate_grid(side, side, 5));
+  for (auto _ : state) {
+    if (state.range(1) == 0) {
+      auto dists = GraphAlgorithms<int>::johnsons(g);
+      benchmark::DoNotOptimize(dists.data());
+    } else if (state.range(1) == 1) {
+      auto dists = GraphAlgorithms<int>::symmetric_apsp(g);
+      benchmark::DoNotOptimize(dists.packed().data());
+    } else if (state.range(1) == 2) {
+      auto dists = process_floyd_warshall(g, 1, 64);
+      benchmark::DoNotOptimize(dists.data());
+    } else {
+      auto dists = GraphAlgorithms<int>::symmetric_floyd_warshall(g);
+      benchmark::DoNotOptimize(dists.packed().data());
+    }
+  }
+  set_graph_counters(state, g);
+}
+
+// rmat graph with 4 edges per node, all labeled 1. arg 1 = 0 for
+// johnsons, 1 for bit_parallel_apsp
+void BM_bit_parallel_apsp(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  for (const auto& [x, label, y] : generate_rmat(state.range(0), 4LL * state.range(0), 13))
+    g.add_edge(x, 1, y);
+  for (auto _ : state) {
+    auto dists = state.range(1) == 0 ? GraphAlgorithms<int>::johnsons(g) : GraphAlgorithms<int>::bit_parallel_apsp(g);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+// square grid with about n nodes whose ids are randomly shuffled, as
+// a loader might assign them. arg 1 = ordering (0 = none, 1 = rcm,
+// 2 = bfs, 3 = degree); the timing includes reordering and mapping
+// the table back, and "span" is the average id distance of an edge
+AdjacencyList<int> shuffled_grid(int n)
+{
+  int side = sqrt(n);
+  vector<int> ids(side * side);
+  for (int x = 0; x < side * side; x++)
+    ids[x] = x;
+  shuffle(ids.begin(), ids.end(), mt19937(17));
+  GraphBuilder<int> builder(side * side, true);
+  for (const auto& [x, label, y] : generate_grid(side, side, 5))
+    builder.add_edge(ids[x], label, ids[y]);
+  return builder.build();
+}
+
+void BM_reordered_apsp(benchmark::State& state)
+{
+  AdjacencyList<int> g = shuffled_grid(state.range(0));
+  auto johnsons = [](const Graph<int>& p) { return GraphAlgorithms<int>::johnsons(p); };
+  VertexOrdering orderings[] = {VertexOrdering::rcm, VertexOrdering::rcm, VertexOrdering::bfs, VertexOrdering::degree};
+  VertexOrdering ordering = orderings[state.range(1)];
+  for (auto _ : state) {
+    auto dists = state.range(1) == 0 ? johnsons(g) : reordered_apsp(g, ordering, johnsons);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+  state.counters["span"] = state.range(1) == 0 ? VertexOrder::edge_span(g)
+    : VertexOrder::edge_span(VertexOrder(g, ordering).permute(g));
+}
+
+// the same graphs, but a single corner to corner dijkstra (which
+// settles most of the grid) on the reordered snapshot, for sizes where
+// the search arrays no longer fit in cache
+void BM_reordered_dijkstra(benchmark::State& state)
+{
+  AdjacencyList<int> g = shuffled_grid(state.range(0));
+  VertexOrdering orderings[] = {VertexOrdering::rcm, VertexOrdering::rcm, VertexOrdering::bfs, VertexOrdering::degree};
+  VertexOrder order(g, orderings[state.range(1)]);
+  AdjacencyList<int> permuted = state.range(1) == 0 ? g : order.permute(g);
+  StaticGraph sg(permuted);
+  int side = sqrt(state.range(0));
+  vector<int> ids(side * side);
+  for (int x = 0; x < side * side; x++)
+    ids[x] = x;
+  shuffle(ids.begin(), ids.end(), mt19937(17));
+  int s = ids[0], t = ids[side * side - 1];
+  if (state.range(1) != 0) {
+    s = order.new_id(s);
+    t = order.new_id(t);
+  }
+  for (auto _ : state) {
+    int d = GraphAlgorithms<int>::dijkstra_single_pair(sg, s, t, false);
+    benchmark::DoNotOptimize(d);
+  }
+  set_graph_counters(state, g);
+  state.counters["span"] = VertexOrder::edge_span(permuted);
+}
+
+void BM_floyd_warshall(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  for (auto _ : state) {
+    auto dists = GraphAlgorithms<int>::floyd_warshall(g);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+// arg 2 = worker processes (64 node tiles)
+void BM_process_floyd_warshall(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  for (auto _ : state) {
+    auto dists = process_floyd_warshall(g, state.range(2), 64);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+// checkpoints to a scratch file that is removed before each run (so
+// nothing is resumed); compare with BM_johnsons and
+// BM_process_floyd_warshall (1 process)
+void BM_checkpointed_johnsons(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  string path = "final_bench_johnsons.ckpt";
+  for (auto _ : state) {
+    state.PauseTiming();
+    remove(path.c_str());
+    state.ResumeTiming();
+    auto dists = checkpointed_johnsons(g, path, 64);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  remove(path.c_str());
+  set_graph_counters(state, g);
+}
+
+void BM_checkpointed_floyd_warshall(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  string path = "final_bench_floyd_warshall.ckpt";
+  for (auto _ : state) {
+    state.PauseTiming();
+    remove(path.c_str());
+    state.ResumeTiming();
+    auto dists = checkpointed_floyd_warshall(g, path, 64);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  remove(path.c_str());
+  set_graph_counters(state, g);
+}
+
+void BM_bellman_ford(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  for (auto _ : state) {
+    auto dists = GraphAlgorithms<int>::bellman_ford_shortest_path(g, 0);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+void BM_dijkstra(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  for (auto _ : state) {
+    auto dists = GraphAlgorithms<int>::dijkstra_shortest_path(g, 0);
+    benchmark::DoNotOptimize(dists.data());
+  }
+  set_graph_counters(state, g);
+}
+
+BENCHMARK(BM_johnsons)->ArgNames({"n", "dense"})->RangeMultiplier(2)
+  ->Ranges({{16, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_johnsons_stream)->ArgNames({"n", "dense"})->RangeMultiplier(2)
+  ->Ranges({{16, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_condensed_apsp)->ArgNames({"n", "dense"})->RangeMultiplier(2)
+  ->Ranges({{16, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_partitioned_apsp)->ArgNames({"n", "partition"})
+  ->ArgsProduct({benchmark::CreateRange(128, johnsons_max, 2), {0, 1, 2}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_many_to_many)->ArgNames({"n", "dense"})->RangeMultiplier(2)
+  ->Ranges({{16, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_symmetric_apsp)->ArgNames({"n", "engine"})
+  ->ArgsProduct({benchmark::CreateRange(64, johnsons_max, 4), {0, 1, 2, 3}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_bit_parallel_apsp)->ArgNames({"n", "bit_parallel"})
+  ->ArgsProduct({benchmark::CreateRange(64, 4 * johnsons_max, 4), {0, 1}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_reordered_apsp)->ArgNames({"n", "ordering"})
+  ->ArgsProduct({benchmark::CreateRange(256, 4 * johnsons_max, 4), {0, 1, 2, 3}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_reordered_dijkstra)->ArgNames({"n", "ordering"})
+  ->ArgsProduct({benchmark::CreateRange(1 << 12, 1 << 20, 16), {0, 1, 2, 3}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_floyd_warshall)->ArgNames({"n", "dense"})->RangeMultiplier(2)
+  ->Ranges({{16, floyd_warshall_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_process_floyd_warshall)->ArgNames({"n", "dense", "processes"})
+  ->ArgsProduct({benchmark::CreateRange(16, process_floyd_warshall_max, 4), {SPARSE, DENSE}, {1, 4}})
+  ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_checkpointed_johnsons)->ArgNames({"n", "dense"})->RangeMultiplier(4)
+  ->Ranges({{64, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_checkpointed_floyd_warshall)->ArgNames({"n", "dense"})->RangeMultiplier(4)
+  ->Ranges({{64, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_bellman_ford)->ArgNames({"n", "dense"})->RangeMultiplier(4)
+  ->Ranges({{64, sssp_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_dijkstra)->ArgNames({"n", "dense"})->RangeMultiplier(4)
+  ->Ranges({{64, sssp_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+
+
+//----------------------------------------------------------------------
+// Compressed distance matrices (arg 0 = node count). The matrices
+// come from johnsons on the engine shapes; "ratio" is the plain
+// n x n int size over the compressed size.
+//----------------------------------------------------------------------
+
+void BM_compress_matrix(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  auto dists = GraphAlgorithms<int>::johnsons(g);
+  size_t bytes = 0;
+  for (auto _ : state) {
+    CompressedMatrix m(dists);
+    bytes = m.byte_size();
+    benchmark::DoNotOptimize(bytes);
+  }
+  set_graph_counters(state, g);
+  state.counters["ratio"] = (double) dists.size() * dists.size() * sizeof(int) / bytes;
+  state.SetBytesProcessed(state.iterations() * dists.size() * dists.size() * sizeof(int));
+}
+
+// decodes every row in a random order
+void BM_compressed_row(benchmark::State& state)
+{
+  AdjacencyList<int> g(state.range(0), true);
+  load_shape(g, state.range(1));
+  CompressedMatrix m(GraphAlgorithms<int>::johnsons(g));
+  vector<int> order(m.rows());
+  for (int i = 0; i < m.rows(); i++)
+    order[i] = (i * 7919L) % m.rows();
+  vector<int> row;
+  for (auto _ : state) {
+    for (int i : order)
+      m.row(i, row);
+    benchmark::DoNotOptimize(row.data());
+  }
+  set_graph_counters(state, g);
+  state.SetItemsProcessed(state.iterations() * m.rows());
+}
+
+BENCHMARK(BM_compress_matrix)->ArgNames({"n", "dense"})->RangeMultiplier(4)
+  ->Ranges({{64, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_compressed_row)->ArgNames({"n", "dense"})->RangeMultiplier(4)
+  ->Ranges({{64, johnsons_max}, {SPARSE, DENSE}})->Unit(benchmark::kMillisecond);
+
+
+//----------------------------------------------------------------------
+// Point-to-point queries on road-like grids (arg 0 = node count). The
+// query benchmarks report the average time per random (s,t) query.
+//----------------------------------------------------------------------
+
+const int queries_per_iteration = 64;
+
+// builds a road-like square grid with about n nodes
+AdjacencyList<int> road_graph(int n)
+{
+  int side = 1;
+  while (side * side < n)
+    ++side;
+  GraphBuilder<int> builder(side * side, true);
+  builder.add_edges(generate_grid(side, side, 1));
+  return builder.build();
+}
+
+// random (s,t) pairs, the same for every engine
+vector<pair<int,int>> query_pairs(int n)
+{
+  vector<pair<int,int>> pairs;
+  for (const auto& [s, label, t] : generate_rmat(n, queries_per_iteration, 99))
+    pairs.push_back({s, t});
+  return pairs;
+}
+
+void BM_ch_build(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  long long shortcuts = 0;
+  for (auto _ : state) {
+    ContractionHierarchy ch(g);
+    shortcuts = ch.shortcut_count();
+  }
+  set_graph_counters(state, g);
+  state.counters["shortcuts"] = shortcuts;
+}
+
+void BM_ch_query(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  ContractionHierarchy ch(g);
+  auto pairs = query_pairs(g.node_count());
+  for (auto _ : state)
+    for (auto [s, t] : pairs)
+      benchmark::DoNotOptimize(ch.distance(s, t));
+  set_graph_counters(state, g);
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+// arg 1 = build threads
+void BM_hub_label_build(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  HubLabelStats stats;
+  for (auto _ : state) {
+    HubLabels labels(g, state.range(1));
+    stats = labels.stats();
+  }
+  set_graph_counters(state, g);
+  state.counters["avg_label"] = stats.average_size;
+  state.counters["max_label"] = stats.max_size;
+  state.counters["label_bytes"] = stats.bytes;
+}
+
+void BM_hub_label_query(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  HubLabels labels(g, 0);
+  auto pairs = query_pairs(g.node_count());
+  for (auto _ : state)
+    for (auto [s, t] : pairs)
+      benchmark::DoNotOptimize(labels.distance(s, t));
+  set_graph_counters(state, g);
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+// arg 1 = selection (0 = farthest, 1 = avoid)
+void BM_alt_build(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  auto selection = state.range(1) ? LandmarkSelection::avoid : LandmarkSelection::farthest;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(AltSearch(g, 16, selection));
+  set_graph_counters(state, g);
+}
+
+void BM_alt_query(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  auto selection = state.range(1) ? LandmarkSelection::avoid : LandmarkSelection::farthest;
+  AltSearch alt(g, 16, selection);
+  auto pairs = query_pairs(g.node_count());
+  for (auto _ : state)
+    for (auto [s, t] : pairs)
+      benchmark::DoNotOptimize(alt.distance(s, t));
+  set_graph_counters(state, g);
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+// arg 1 = bidirectional
+void BM_single_pair_dijkstra(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  StaticGraph sg(g);
+  auto pairs = query_pairs(g.node_count());
+  for (auto _ : state)
+    for (auto [s, t] : pairs)
+      benchmark::DoNotOptimize(GraphAlgorithms<int>::dijkstra_single_pair(sg, s, t, state.range(1)));
+  set_graph_counters(state, g);
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+// baseline: a full single-source dijkstra per query
+void BM_dijkstra_query(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  vector<int> potentials(g.node_count(), 0);
+  auto pairs = query_pairs(g.node_count());
+  for (auto _ : state)
+    for (auto [s, t] : pairs)
+      benchmark::DoNotOptimize(GraphAlgorithms<int>::johnsons_query(g, potentials, s)[t]);
+  set_graph_counters(state, g);
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+BENCHMARK(BM_ch_build)->RangeMultiplier(4)->Range(1 << 10, point_to_point_max)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ch_query)->RangeMultiplier(4)->Range(1 << 10, point_to_point_max)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_hub_label_build)->ArgNames({"n", "threads"})->RangeMultiplier(4)
+  ->Ranges({{1 << 10, point_to_point_max}, {1, 4}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_hub_label_query)->RangeMultiplier(4)->Range(1 << 10, point_to_point_max)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_alt_build)->ArgNames({"n", "avoid"})->RangeMultiplier(4)
+  ->Ranges({{1 << 10, point_to_point_max}, {0, 1}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_alt_query)->ArgNames({"n", "avoid"})->RangeMultiplier(4)
+  ->Ranges({{1 << 10, point_to_point_max}, {0, 1}})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_single_pair_dijkstra)->ArgNames({"n", "bidirectional"})->RangeMultiplier(4)
+  ->Ranges({{1 << 10, point_to_point_max}, {0, 1}})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_dijkstra_query)->RangeMultiplier(4)->Range(1 << 10, point_to_point_max)->Unit(benchmark::kMicrosecond);
+
+
+//----------------------------------------------------------------------
+// Queries while a writer thread keeps changing edge labels (arg 0 =
+// node count, arg 1 = 0 for a SnapshotGraph, 1 for an AdjacencyList
+// behind a mutex). Each query is one dijkstra on a road-like grid;
+// the writer changes 64 labels per batch. "versions" is the number of
+// batches published per second.
+//----------------------------------------------------------------------
+
+void BM_snapshot_query(benchmark::State& state)
+{
+  AdjacencyList<int> g = road_graph(state.range(0));
+  int n = g.node_count();
+  bool locked = state.range(1) == 1;
+  SnapshotGraph snapshots(g);
+  mutex lock;
+  atomic<bool> done(false);
+  atomic<long long> batches(0);
+  auto edges = generate_rmat(n, 1 << 16, 3);
+  thread writer([&] {
+    size_t next = 0;
+    while (!done) {
+      unique_lock<mutex> guard(lock, defer_lock);
+      if (locked)
+        guard.lock();
+      for (int i = 0; i < 64; i++, next = (next + 1) % edges.size()) {
+        auto [x, label, y] = edges[next];
+        int from = x % n, to = (from + 1) % n;
+        if (locked)
+          g.set_label(from, label, to);
+        else
+          snapshots.set_label(from, label, to);
+      }
+      if (locked)
+        guard.unlock();
+      else
+        snapshots.publish();
+      batches++;
+      this_thread::yield();
+    }
+  });
+  auto pairs = query_pairs(n);
+  size_t next = 0;
+  for (auto _ : state) {
+    int s = pairs[next++ % pairs.size()].first;
+    if (locked) {
+      lock_guard<mutex> guard(lock);
+      benchmark::DoNotOptimize(GraphAlgorithms<int>::dijkstra_shortest_path(g, s).data());
+    } else {
+      auto pinned = snapshots.pin();
+      benchmark::DoNotOptimize(GraphAlgorithms<int>::dijkstra_shortest_path(pinned.graph(), s).data());
+    }
+  }
+  done = true;
+  writer.join();
+  set_graph_counters(state, g);
+  state.counters["versions"] = benchmark::Counter(batches, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_snapshot_query)->ArgNames({"n", "locked"})
+  ->ArgsProduct({benchmark::CreateRange(1 << 8, 1 << 12, 4), {0, 1}})->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+//----------------------------------------------------------------------
+// Scheduled jobs (arg 0 = node count of a large Floyd-Warshall job
+// already running on one worker, arg 1 = 0 to submit the small job as
+// interactive, 1 to submit it at the large job's priority). The time
+// is the latency of a small (n = 64) Johnson's job submitted once the
+// large job has finished its first step.
+//----------------------------------------------------------------------
+
+void BM_scheduler_latency(benchmark::State& state)
+{
+  AdjacencyList<int> large(state.range(0), true);
+  load_shape(large, SPARSE);
+  AdjacencyList<int> small(64, true);
+  load_shape(small, SPARSE);
+  ApspScheduler scheduler(1);
+  ApspJobOptions large_options;
+  large_options.engine = ApspEngine::floyd_warshall;
+  large_options.priority = JobPriority::batch;
+  ApspJobOptions small_options;
+  small_options.priority = state.range(1) == 0 ? JobPriority::interactive : JobPriority::batch;
+  for (auto _ : state) {
+    ApspJob background = scheduler.submit(large, large_options);
+    while (background.progress() == 0)
+      this_thread::yield();
+    auto start = chrono::steady_clock::now();
+    benchmark::DoNotOptimize(scheduler.submit(small, small_options).get().data());
+    state.SetIterationTime(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    background.cancel();
+    background.wait();
+  }
+  set_graph_counters(state, large);
+}
+
+BENCHMARK(BM_scheduler_latency)->ArgNames({"n", "fifo"})
+  ->ArgsProduct({benchmark::CreateRange(256, 1024, 2), {0, 1}})->Unit(benchmark::kMillisecond)->UseManualTime();
+
+//----------------------------------------------------------------------
+// Many small graphs (arg 0 = nodes per graph, arg 1 = 0 for
+// GraphAlgorithms::floyd_warshall on each graph, 1 for a
+// SmallGraphBatch, counting packing and unpacking). Items are graphs.
+//----------------------------------------------------------------------
+
+const int small_graphs = 1024;
+
+void BM_small_graph_batch(benchmark::State& state)
+{
+  int n = state.range(0);
+  vector<AdjacencyList<int>> graphs;
+  for (int i = 0; i < small_graphs; i++) {
+    graphs.emplace_back(n, true);
+    load_edges(graphs.back(), generate_rmat(n, 3 * n, i, true));
+  }
+  for (auto _ : state) {
+    if (state.range(1) == 0) {
+      for (const auto& g : graphs)
+        benchmark::DoNotOptimize(GraphAlgorithms<int>::floyd_warshall(g).data());
+    } else {
+      SmallGraphBatch batch;
+      for (const auto& g : graphs)
+        batch.add(g);
+      batch.solve();
+      benchmark::DoNotOptimize(batch.distances().data());
+    }
+  }
+  set_graph_counters(state, graphs[0]);
+  state.SetItemsProcessed(state.iterations() * small_graphs);
+}
+
+BENCHMARK(BM_small_graph_batch)->ArgNames({"n", "batched"})
+  ->ArgsProduct({{8, 16, 32, 64}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+
+//----------------------------------------------------------------------
+// Driver
+//----------------------------------------------------------------------
+
+// true if the flag (e.g., "--benchmark_out") was given on the command line
+bool has_flag(int argc, char* argv[], const char* flag)
+{
+  for (int i = 1; i < argc; ++i)
+    if (strncmp(argv[i], flag, strlen(flag)) == 0)
+      return true;
+  return false;
+}
+
+int main(int argc, char* argv[])
+{
+  // default to repeated runs with aggregate statistics and json output
+  vector<string> defaults;
+  if (!has_flag(argc, argv, "--benchmark_repetitions"))
+    defaults.push_back("--benchmark_repetitions=" + to_string(repetitions));
+  if (!has_flag(argc, argv, "--benchmark_report_aggregates_only") &&
+      !has_flag(argc, argv, "--benchmark_display_aggregates_only"))
+    defaults.push_back("--benchmark_display_aggregates_only=true");
+  if (!has_flag(argc, argv, "--benchmark_out="))
+    defaults.push_back("--benchmark_out=final_bench.json");
+  if (!has_flag(argc, argv, "--benchmark_out_format"))
+    defaults.push_back("--benchmark_out_format=json");
+
+  vector<char*> args(argv, argv + argc);
+  for (string& arg : defaults)
+    args.push_back(&arg[0]);
+  int args_count = args.size();
+
+  benchmark::Initialize(&args_count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(args_count, args.data()))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -9,7 +9,10 @@
 //       save this data to a file, run the command:
 //          ./final_perf > perf_output.dat
 //       This file can then be used by the plotting script to generate
-//       the corresponding performance graphs.
+//       the corresponding performance graphs. To also record hardware
+//       performance counters (Linux only) for each timed region, run:
+//          ./final_perf --hw > perf_output.dat
+//       which appends the counter columns described in the header.
 //---------------------------------------------------------------------------
 
 #include <iostream>
@@ -18,6 +21,7 @@
 #include <vector>
 #include <set>
 #include <chrono>
+#include <cstring>
 #include "util.h"
 #include "adjacency_list.h"
 #include "graph_algorithms.h"
@@ -32,11 +36,14 @@ const int stop = 120;
 const int runs = 1;
 
 // function prototypes
-double timed_johnsons(const Graph<int>&);
-double timed_floyd_warshall(const Graph<int>&);
+double timed_johnsons(const Graph<int>&, HardwareCounters* = nullptr);
+double timed_floyd_warshall(const Graph<int>&, HardwareCounters* = nullptr);
+HardwareCounters per_run(const HardwareCounters&);
 
 int main(int argc, char* argv[])
 {
+  // check for hardware counter collection
+  bool hw = argc > 1 && strcmp(argv[1], "--hw") == 0;
   
   // configure remaining output
   cout << fixed << showpoint;
@@ -50,6 +57,17 @@ int main(int argc, char* argv[])
   cout << "# Column 3 = adj-list sparse floyd warshall" << endl;
   cout << "# Column 4 = adj-list dense johnsons" << endl;
   cout << "# Column 5 = adj-list dense floyd warshall" << endl;
+  if (hw) {
+    const char* cells[] = {"sparse johnsons", "sparse floyd warshall",
+                           "dense johnsons", "dense floyd warshall"};
+    const char* events[] = {"cycles", "instructions", "L1d misses",
+                            "LLC misses", "branch misses"};
+    cout << "# Hardware counters per run (NaN = unavailable)" << endl;
+    int column = 6;
+    for (const char* cell : cells)
+      for (const char* event : events)
+        cout << "# Column " << column++ << " = adj-list " << cell << " " << event << endl;
+  }
   
   // generate the timing data
   for (int n = start; n <= stop; n += step) {
@@ -67,13 +85,21 @@ int main(int argc, char* argv[])
     load_sparse(sparse_floyd_warshall_graph);
     load_dense(dense_floyd_warshall_graph, 0.1); // small to keep overall time down
 
+    // hardware counters for each result (only used with --hw)
+    HardwareCounters counters[4];
+
     // sparse results
-    cout << timed_johnsons(sparse_johnsons_graph) << " " << flush;
-    cout << timed_floyd_warshall(sparse_floyd_warshall_graph) << " " << flush;
+    cout << timed_johnsons(sparse_johnsons_graph, hw ? &counters[0] : nullptr) << " " << flush;
+    cout << timed_floyd_warshall(sparse_floyd_warshall_graph, hw ? &counters[1] : nullptr) << " " << flush;
 
     // dense results
-    cout << timed_johnsons(dense_johnsons_graph) << " " << flush;
-    cout << timed_floyd_warshall(dense_floyd_warshall_graph) << " " << flush;  
+    cout << timed_johnsons(dense_johnsons_graph, hw ? &counters[2] : nullptr) << " " << flush;
+    cout << timed_floyd_warshall(dense_floyd_warshall_graph, hw ? &counters[3] : nullptr) << " " << flush;  
+
+    // counter results
+    if (hw)
+      for (const HardwareCounters& c : counters)
+        write_hw_columns(cout, per_run(c));
 
     // end row
     cout << endl;
@@ -81,16 +107,20 @@ int main(int argc, char* argv[])
   
 }
 
-double timed_johnsons(const Graph<int>& g)
+double timed_johnsons(const Graph<int>& g, HardwareCounters* counters)
 {
   double total = 0.0;
   int n = g.node_count();
   for (int i = 0; i < runs; ++i) {
+    if (counters)
+      hw_counters_start();
     auto t0 = high_resolution_clock::now();
     auto cliques = GraphAlgorithms<int>::johnsons(g);
     if (n > 0)
       assert(cliques.size() > 0);
     auto t1 = high_resolution_clock::now();
+    if (counters)
+      *counters += hw_counters_stop();
     total += duration_cast<microseconds>(t1 - t0).count();
   }
   if (g.node_count() <= 0)
@@ -98,19 +128,34 @@ double timed_johnsons(const Graph<int>& g)
   return (total/runs);
 }
 
-double timed_floyd_warshall(const Graph<int>& g)
+double timed_floyd_warshall(const Graph<int>& g, HardwareCounters* counters)
 {
   double total = 0.0;
   int n = g.node_count();
   for (int i = 0; i < runs; ++i) {
+    if (counters)
+      hw_counters_start();
     auto t0 = high_resolution_clock::now();
     auto cliques = GraphAlgorithms<int>::floyd_warshall(g);
     if (n > 0)
       assert(cliques.size() > 0);
     auto t1 = high_resolution_clock::now();
+    if (counters)
+      *counters += hw_counters_stop();
     total += duration_cast<microseconds>(t1 - t0).count();
   }
   if (g.node_count() <= 0)
     return 0.0;
   return (total/runs);
 }
+
+HardwareCounters per_run(const HardwareCounters& c)
+{
+  HardwareCounters avg = c;
+  long long* values[] = {&avg.cycles, &avg.instructions, &avg.l1d_misses,
+                         &avg.llc_misses, &avg.branch_misses};
+  for (long long* value : values)
+    if (*value >= 0)
+      *value /= runs;
+  return avg;
+}
@@ -6,10 +6,23 @@
 //----------------------------------------------------------------------
 
 #include <iostream>
+#include <sstream>
 #include <gtest/gtest.h>
 #include "graph.h"
 #include "adjacency_list.h"
+#include "graph_builder.h"
 #include "graph_algorithms.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
+#include "alt_search.h"
+#include "process_floyd_warshall.h"
+#include "compressed_matrix.h"
+#include "checkpoint.h"
+#include "vertex_order.h"
+#include "snapshot_graph.h"
+#include "apsp_scheduler.h"
+#include "small_graph_batch.h"
+#include "util.h"
 
 using std::nullopt;
 using std::vector;
@@ -26,6 +39,37 @@ bool contains_set(vector<set<int>> sets, set<int> s)
   return false;
 }
 
+// the graphs engines are checked against johnsons on: a side x side
+// grid, an R-MAT graph and an undirected geometric graph, each with
+// side * side nodes. With negative the grid and R-MAT graph get
+// negative labels (without negative cycles); with undirected they are
+// undirected as well (and negative is ignored).
+vector<AdjacencyList<int>> test_graphs(bool negative = false, bool undirected = false, int side = 10)
+{
+  int n = side * side;
+  negative = negative && !undirected;
+  vector<AdjacencyList<int>> graphs;
+  graphs.emplace_back(n, !undirected);
+  load_edges(graphs.back(), generate_grid(side, side, 2, negative));
+  graphs.emplace_back(n, !undirected);
+  load_edges(graphs.back(), generate_rmat(n, 4 * n, 3, negative));
+  graphs.emplace_back(n, false);
+  load_edges(graphs.back(), generate_geometric(n, 2.0 / side, 4));
+  return graphs;
+}
+
+// sparse and dense regions joined by a few edges each way
+void load_blocks(Graph<int>& g)
+{
+  load_sparse(g, 0, 39);
+  load_dense(g, 0.3, 40, 80);
+  load_sparse(g, 80, 119);
+  g.add_edge(10, 5, 45);
+  g.add_edge(70, 2, 20);
+  g.add_edge(79, 7, 100);
+  g.add_edge(119, 1, 0);
+}
+
 
 //----------------------------------------------------------------------
 // Johnson's Tests
@@ -301,6 +345,1578 @@ TEST(BasicFloydWarshallTests, FourNodeTest) {
   ASSERT_EQ(0, path_costs[3][3]);
 }
 
+//----------------------------------------------------------------------
+// Statistics Tests
+//----------------------------------------------------------------------
+
+#ifdef APSP_STATS
+
+TEST(AlgorithmStatsTests, FloydWarshallCountsTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0,1,1);
+  g.add_edge(1,2,2);
+  g.add_edge(2,3,0);
+  AlgorithmStats stats;
+  GraphAlgorithms<int>::floyd_warshall(g, &stats);
+  ASSERT_EQ(3, stats.pivot_phases);
+  ASSERT_EQ(27, stats.relaxations);
+  ASSERT_EQ(0, stats.bellman_ford_rounds);
+  ASSERT_LT(0, stats.successful_relaxations);
+  ASSERT_LT(0, stats.bytes_allocated);
+}
+
+TEST(AlgorithmStatsTests, JohnsonsCountsTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0,1,1);
+  g.add_edge(1,2,2);
+  g.add_edge(2,3,0);
+  AlgorithmStats stats;
+  GraphAlgorithms<int>::johnsons(g, &stats);
+  ASSERT_EQ(1, stats.bellman_ford_rounds);  // no negative edges
+  ASSERT_EQ(0, stats.pivot_phases);
+  ASSERT_EQ(9, stats.heap_pushes);          // 3 nodes per dijkstra pass
+  ASSERT_EQ(9, stats.heap_pops);
+  ASSERT_EQ(12, stats.relaxations);         // 3 per pass plus 3 in prepare
+  ASSERT_LE(stats.successful_relaxations, stats.relaxations);
+  ASSERT_LT(0, stats.bytes_allocated);
+}
+
+TEST(AlgorithmStatsTests, NullStatsTest) {
+  AdjacencyList<int> g(2, true);
+  g.add_edge(0,1,1);
+  auto path_costs = GraphAlgorithms<int>::dijkstra_shortest_path(g, 0, nullptr);
+  ASSERT_EQ(1, path_costs[1]);
+}
+
+#endif
+
+//----------------------------------------------------------------------
+// Generator Tests
+//----------------------------------------------------------------------
+
+TEST(GeneratorTests, RmatDeterministicTest) {
+  auto one_thread = generate_rmat(1000, 100000, 7, false, 100, 1);
+  auto four_threads = generate_rmat(1000, 100000, 7, false, 100, 4);
+  ASSERT_EQ(100000, one_thread.size());
+  ASSERT_EQ(one_thread, four_threads);
+  for (auto [x, label, y] : one_thread) {
+    ASSERT_NE(x, y);
+    ASSERT_TRUE(x >= 0 && x < 1000 && y >= 0 && y < 1000);
+    ASSERT_TRUE(label >= 1 && label <= 100);
+  }
+  ASSERT_NE(one_thread, generate_rmat(1000, 100000, 8, false, 100, 1));
+}
+
+TEST(GeneratorTests, GridEdgeCountTest) {
+  auto edges = generate_grid(3, 4, 1);
+  ASSERT_EQ(34, edges.size());
+  AdjacencyList<int> g(12, true);
+  load_edges(g, edges);
+  ASSERT_EQ(34, g.edge_count());
+  ASSERT_TRUE(g.has_edge(0, 1) && g.has_edge(1, 0));
+  ASSERT_TRUE(g.has_edge(0, 4) && g.has_edge(4, 0));
+  ASSERT_FALSE(g.has_edge(3, 4));
+}
+
+TEST(GeneratorTests, GeometricSymmetricTest) {
+  // every edge has its reverse edge
+  auto edges = generate_geometric(300, 0.1, 3, false, 100, 2);
+  AdjacencyList<int> g(300, true);
+  load_edges(g, edges);
+  ASSERT_EQ(edges.size(), g.edge_count());
+  for (auto [x, label, y] : edges) {
+    ASSERT_TRUE(g.has_edge(y, x));
+    ASSERT_TRUE(label >= 1 && label <= 100);
+  }
+  ASSERT_EQ(edges, generate_geometric(300, 0.1, 3, false, 100, 1));
+}
+
+TEST(GeneratorTests, NegativeLabelsNoNegativeCycleTest) {
+  auto edges = generate_grid(6, 6, 11, true, 10);
+  bool has_negative = false;
+  for (auto [x, label, y] : edges)
+    has_negative = has_negative || label < 0;
+  ASSERT_TRUE(has_negative);
+  AdjacencyList<int> g(36, true);
+  load_edges(g, edges);
+  ASSERT_EQ(36, GraphAlgorithms<int>::bellman_ford_shortest_path(g, 0).size());
+  ASSERT_EQ(GraphAlgorithms<int>::floyd_warshall(g), GraphAlgorithms<int>::johnsons(g));
+}
+
+//----------------------------------------------------------------------
+// Graph Builder Tests
+//----------------------------------------------------------------------
+
+TEST(GraphBuilderTests, DirectedDuplicatesTest) {
+  GraphBuilder<int> builder(3, true);
+  builder.add_edge(0, 5, 1);
+  builder.add_edge(2, 1, 0);
+  builder.add_edge(0, 7, 1);   // duplicate, first label kept
+  builder.add_edge(1, 2, 0);
+  builder.add_edge(0, 1, 3);   // invalid node
+  ASSERT_EQ(4, builder.queued_count());
+  AdjacencyList<int> g = builder.build();
+  ASSERT_EQ(3, g.edge_count());
+  ASSERT_EQ(5, g.get_label(0, 1).value());
+  ASSERT_EQ(1, g.get_label(2, 0).value());
+  ASSERT_EQ(2, g.get_label(1, 0).value());
+  ASSERT_FALSE(g.has_edge(1, 2));
+  ASSERT_EQ(0, builder.queued_count());
+}
+
+TEST(GraphBuilderTests, UndirectedTest) {
+  GraphBuilder<int> builder(3, false);
+  builder.add_edge(1, 4, 0);
+  builder.add_edge(0, 9, 1);   // same undirected edge
+  builder.add_edges({{1, 2, 2}, {2, 3, 0}});
+  AdjacencyList<int> g = builder.build();
+  ASSERT_FALSE(g.is_directed());
+  ASSERT_EQ(3, g.edge_count());
+  ASSERT_EQ(4, g.get_label(0, 1).value());
+  ASSERT_EQ(4, g.get_label(1, 0).value());
+  ASSERT_EQ(2, g.get_label(2, 1).value());
+  ASSERT_EQ(3, g.get_label(0, 2).value());
+}
+
+TEST(GraphBuilderTests, MatchesAddEdgeTest) {
+  auto edges = generate_rmat(200, 5000, 5);
+  AdjacencyList<int> expected(200, true);
+  load_edges(expected, edges);
+  for (int threads : {1, 4}) {
+    GraphBuilder<int> builder(200, true);
+    builder.add_edges(edges);
+    AdjacencyList<int> g = builder.build(threads);
+    ASSERT_EQ(expected.edge_count(), g.edge_count());
+    for (int x = 0; x < 200; x++) {
+      auto out = g.out_nodes(x);
+      auto expected_out = expected.out_nodes(x);
+      std::sort(expected_out.begin(), expected_out.end());
+      ASSERT_EQ(expected_out, out);
+      for (int y : out)
+        ASSERT_EQ(expected.get_label(x, y), g.get_label(x, y));
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+// Node Pool Tests
+//----------------------------------------------------------------------
+
+TEST(NodePoolTests, ReuseFreedNodeTest) {
+  NodePool pool(24, 4);
+  void* a = pool.allocate();
+  void* b = pool.allocate();
+  ASSERT_NE(a, b);
+  pool.deallocate(a);
+  ASSERT_EQ(a, pool.allocate());
+  for (int i = 0; i < 3; i++)
+    pool.allocate();
+  ASSERT_EQ(2 * 4 * pool.node_size(), pool.capacity_bytes());
+}
+
+TEST(NodePoolTests, PooledGraphTest) {
+  PooledAdjacencyList<int> g(4, true);
+  g.add_edge(0, 3, 1);
+  g.add_edge(1, 4, 2);
+  g.add_edge(2, 5, 3);
+  size_t bytes = g.get_allocator().pool_bytes();
+  ASSERT_LT(0, bytes);
+  // removed edges are reused without growing the pool
+  for (int i = 0; i < 5000; i++) {
+    g.rem_edge(1, 2);
+    g.add_edge(1, i, 2);
+  }
+  ASSERT_EQ(bytes, g.get_allocator().pool_bytes());
+  ASSERT_EQ(3, g.edge_count());
+  ASSERT_EQ(4999, g.get_label(1, 2).value());
+  // copies get their own pool
+  PooledAdjacencyList<int> copy(g);
+  ASSERT_FALSE(copy.get_allocator() == g.get_allocator());
+  g.rem_edge(0, 1);
+  ASSERT_TRUE(copy.has_edge(0, 1));
+  ASSERT_FALSE(g.has_edge(0, 1));
+  copy = g;
+  ASSERT_FALSE(copy.has_edge(0, 1));
+  ASSERT_EQ(2, copy.edge_count());
+}
+
+TEST(NodePoolTests, PooledUndirectedBuilderTest) {
+  GraphBuilder<int> builder(3, false);
+  builder.add_edges({{0, 1, 1}, {1, 2, 2}});
+  PooledAdjacencyList<int> g = builder.build(1, PoolAllocator<std::pair<std::optional<int>,int>>());
+  ASSERT_EQ(2, g.edge_count());
+  ASSERT_EQ(1, g.get_label(1, 0).value());
+  ASSERT_EQ((vector<int>{0, 2}), g.adjacent(1));
+}
+
+//----------------------------------------------------------------------
+// Johnson's Phases Tests
+//----------------------------------------------------------------------
+
+TEST(JohnsonsPhasesTests, NegativeEdgesTest) {
+  AdjacencyList<int> g(4, true);
+  g.add_edge(0, 4, 1);
+  g.add_edge(1, -2, 2);
+  g.add_edge(2, 3, 3);
+  g.add_edge(0, 5, 3);
+  g.add_edge(3, -1, 1);
+  auto potentials = GraphAlgorithms<int>::johnsons_prepare(g);
+  ASSERT_EQ(4, potentials.size());
+  ASSERT_TRUE(GraphAlgorithms<int>::johnsons_potentials_valid(g, potentials));
+  auto from_zero = GraphAlgorithms<int>::johnsons_query(g, potentials, 0);
+  ASSERT_EQ((vector<int>{0, 4, 2, 5}), from_zero);
+  auto from_two = GraphAlgorithms<int>::johnsons_query(g, potentials, 2);
+  ASSERT_EQ(std::numeric_limits<int>::max(), from_two[0]);
+  ASSERT_EQ(2, from_two[1]);
+  ASSERT_EQ(GraphAlgorithms<int>::floyd_warshall(g), GraphAlgorithms<int>::johnsons(g));
+}
+
+TEST(JohnsonsPhasesTests, NegativeCycleTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, -3, 2);
+  g.add_edge(2, 1, 0);
+  ASSERT_TRUE(GraphAlgorithms<int>::johnsons_prepare(g).empty());
+  ASSERT_TRUE(GraphAlgorithms<int>::johnsons(g).empty());
+}
+
+TEST(JohnsonsPhasesTests, ReusePotentialsAfterDecreaseTest) {
+  AdjacencyList<int> g(36, true);
+  load_edges(g, generate_grid(6, 6, 4, true, 20));
+  auto potentials = GraphAlgorithms<int>::johnsons_prepare(g);
+  ASSERT_FALSE(potentials.empty());
+  // decrease labels while the reduced costs stay non-negative
+  int decreased = 0;
+  for (int u = 0; u < 36; u++) {
+    for (int v : g.out_nodes(u)) {
+      int label = g.get_label(u, v).value() - 3;
+      if (GraphAlgorithms<int>::johnsons_potentials_valid(potentials, u, label, v)) {
+        g.set_label(u, label, v);
+        decreased++;
+      }
+    }
+  }
+  ASSERT_LT(0, decreased);
+  ASSERT_TRUE(GraphAlgorithms<int>::johnsons_potentials_valid(g, potentials));
+  ASSERT_EQ(GraphAlgorithms<int>::floyd_warshall(g), GraphAlgorithms<int>::johnsons(g, potentials));
+  // a decrease that breaks the potentials is detected
+  int label = g.get_label(0, 1).value() - 1000;
+  ASSERT_FALSE(GraphAlgorithms<int>::johnsons_potentials_valid(potentials, 0, label, 1));
+}
+
+//----------------------------------------------------------------------
+// Contraction Hierarchy Tests
+//----------------------------------------------------------------------
+
+TEST(ContractionHierarchyTests, SmallDirectedTest) {
+  AdjacencyList<int> g(4, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, 2, 2);
+  g.add_edge(0, 6, 2);
+  g.add_edge(2, 1, 3);
+  ContractionHierarchy ch(g);
+  ASSERT_EQ(0, ch.distance(0, 0));
+  ASSERT_EQ(1, ch.distance(0, 1));
+  ASSERT_EQ(3, ch.distance(0, 2));
+  ASSERT_EQ(4, ch.distance(0, 3));
+  ASSERT_EQ(std::numeric_limits<int>::max(), ch.distance(3, 0));
+  ASSERT_EQ(std::numeric_limits<int>::max(), ch.distance(1, 0));
+}
+
+TEST(ContractionHierarchyTests, MatchesJohnsonsTest) {
+  for (const auto& g : test_graphs()) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    ContractionHierarchy ch(g, 20);
+    for (int s = 0; s < 100; s++)
+      for (int t = 0; t < 100; t++)
+        ASSERT_EQ(expected[s][t], ch.distance(s, t));
+  }
+}
+
+//----------------------------------------------------------------------
+// Hub Label Tests
+//----------------------------------------------------------------------
+
+TEST(HubLabelTests, SmallDirectedTest) {
+  AdjacencyList<int> g(4, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, 2, 2);
+  g.add_edge(0, 6, 2);
+  g.add_edge(2, 1, 3);
+  HubLabels labels(g);
+  ASSERT_EQ(0, labels.distance(0, 0));
+  ASSERT_EQ(1, labels.distance(0, 1));
+  ASSERT_EQ(3, labels.distance(0, 2));
+  ASSERT_EQ(4, labels.distance(0, 3));
+  ASSERT_EQ(std::numeric_limits<int>::max(), labels.distance(3, 0));
+  ASSERT_EQ(std::numeric_limits<int>::max(), labels.distance(1, 0));
+}
+
+TEST(HubLabelTests, MatchesJohnsonsTest) {
+  for (const auto& g : test_graphs()) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    HubLabels sequential(g, 1);
+    HubLabels parallel(g, 4);
+    for (int s = 0; s < 100; s++) {
+      for (int t = 0; t < 100; t++) {
+        ASSERT_EQ(expected[s][t], sequential.distance(s, t));
+        ASSERT_EQ(expected[s][t], parallel.distance(s, t));
+      }
+    }
+  }
+}
+
+TEST(HubLabelTests, StatsTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, 1, 2);
+  HubLabels labels(g);
+  HubLabelStats stats = labels.stats();
+  // node 1 (highest degree) covers every path, plus each node's
+  // own entries
+  ASSERT_EQ(8, stats.entries);
+  ASSERT_EQ(2, stats.max_size);
+  ASSERT_DOUBLE_EQ(8.0 / 6.0, stats.average_size);
+  ASSERT_LT(0, stats.bytes);
+}
+
+TEST(HubLabelTests, ReadWriteTest) {
+  AdjacencyList<int> g(100, true);
+  load_edges(g, generate_rmat(100, 400, 5));
+  HubLabels labels(g);
+  std::stringstream buffer;
+  ASSERT_TRUE(labels.write(buffer));
+  HubLabels copy;
+  ASSERT_TRUE(copy.read(buffer));
+  ASSERT_EQ(100, copy.node_count());
+  ASSERT_EQ(labels.stats().entries, copy.stats().entries);
+  for (int s = 0; s < 100; s++)
+    for (int t = 0; t < 100; t++)
+      ASSERT_EQ(labels.distance(s, t), copy.distance(s, t));
+  // truncated data is rejected
+  std::string data = buffer.str();
+  std::stringstream truncated(data.substr(0, data.size() / 2));
+  ASSERT_FALSE(copy.read(truncated));
+  ASSERT_EQ(0, copy.node_count());
+}
+
+TEST(HubLabelTests, CorruptCountsTest) {
+  // counts far larger than the data are rejected without allocating
+  // for them
+  auto header = [](int n, long long entries) {
+    std::string data = "HUBL";
+    data.append(reinterpret_cast<const char*>(&n), sizeof(int));
+    data.append(reinterpret_cast<const char*>(&entries), sizeof(long long));
+    return data;
+  };
+  HubLabels labels;
+  std::stringstream huge_n(header(std::numeric_limits<int>::max(), 0));
+  ASSERT_FALSE(labels.read(huge_n));
+  std::stringstream huge_entries(header(2, std::numeric_limits<long long>::max()) + std::string(40, '\0'));
+  ASSERT_FALSE(labels.read(huge_entries));
+  // a label larger than the node count
+  std::string data = header(1, 5);
+  int size = 5;
+  data.append(reinterpret_cast<const char*>(&size), sizeof(int));
+  data.append(64, '\0');
+  std::stringstream huge_label(data);
+  ASSERT_FALSE(labels.read(huge_label));
+  ASSERT_EQ(0, labels.node_count());
+}
+
+//----------------------------------------------------------------------
+// ALT Search Tests
+//----------------------------------------------------------------------
+
+TEST(AltSearchTests, SmallDirectedTest) {
+  AdjacencyList<int> g(4, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, 2, 2);
+  g.add_edge(0, 6, 2);
+  g.add_edge(2, 1, 3);
+  AltSearch alt(g, 2);
+  ASSERT_EQ(2, alt.landmarks().size());
+  ASSERT_EQ(0, alt.distance(0, 0));
+  ASSERT_EQ(1, alt.distance(0, 1));
+  ASSERT_EQ(3, alt.distance(0, 2));
+  ASSERT_EQ(4, alt.distance(0, 3));
+  ASSERT_EQ(std::numeric_limits<int>::max(), alt.distance(3, 0));
+  ASSERT_EQ(std::numeric_limits<int>::max(), alt.distance(1, 0));
+}
+
+TEST(AltSearchTests, MatchesJohnsonsTest) {
+  for (const auto& g : test_graphs()) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    for (auto selection : {LandmarkSelection::farthest, LandmarkSelection::avoid}) {
+      AltSearch alt(g, 4, selection);
+      ASSERT_EQ(4, alt.landmarks().size());
+      for (int s = 0; s < 100; s++) {
+        for (int t = 0; t < 100; t++) {
+          ASSERT_EQ(expected[s][t], alt.distance(s, t));
+          // the bound never overestimates
+          ASSERT_LE(alt.lower_bound(s, t), expected[s][t]);
+        }
+      }
+    }
+  }
+}
+
+#ifdef APSP_STATS
+TEST(AltSearchTests, SmallerSearchTest) {
+  AdjacencyList<int> g(900, true);
+  load_edges(g, generate_grid(30, 30, 6));
+  AltSearch alt(g, 8);
+  vector<int> zero(900, 0);
+  AlgorithmStats alt_stats, dijkstra_stats;
+  for (int s = 0; s < 900; s += 97) {
+    int t = 899 - s;
+    ASSERT_EQ(GraphAlgorithms<int>::johnsons_query(g, zero, s, &dijkstra_stats)[t],
+              alt.distance(s, t, &alt_stats));
+  }
+  ASSERT_LT(alt_stats.heap_pops * 2, dijkstra_stats.heap_pops);
+}
+#endif
+
+//----------------------------------------------------------------------
+// Single Pair Dijkstra Tests
+//----------------------------------------------------------------------
+
+TEST(SinglePairDijkstraTests, SmallDirectedTest) {
+  AdjacencyList<int> g(4, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, 2, 2);
+  g.add_edge(0, 6, 2);
+  g.add_edge(2, 1, 3);
+  StaticGraph sg(g);
+  for (bool bidirectional : {false, true}) {
+    ASSERT_EQ(0, GraphAlgorithms<int>::dijkstra_single_pair(sg, 0, 0, bidirectional));
+    ASSERT_EQ(1, GraphAlgorithms<int>::dijkstra_single_pair(sg, 0, 1, bidirectional));
+    ASSERT_EQ(3, GraphAlgorithms<int>::dijkstra_single_pair(sg, 0, 2, bidirectional));
+    ASSERT_EQ(4, GraphAlgorithms<int>::dijkstra_single_pair(sg, 0, 3, bidirectional));
+    ASSERT_EQ(std::numeric_limits<int>::max(), GraphAlgorithms<int>::dijkstra_single_pair(sg, 3, 0, bidirectional));
+    ASSERT_EQ(std::numeric_limits<int>::max(), GraphAlgorithms<int>::dijkstra_single_pair(sg, 0, 4, bidirectional));
+  }
+}
+
+TEST(SinglePairDijkstraTests, MatchesJohnsonsTest) {
+  for (const auto& g : test_graphs()) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    StaticGraph sg(g);
+    for (int s = 0; s < 100; s++) {
+      for (int t = 0; t < 100; t++) {
+        ASSERT_EQ(expected[s][t], GraphAlgorithms<int>::dijkstra_single_pair(sg, s, t, false));
+        ASSERT_EQ(expected[s][t], GraphAlgorithms<int>::dijkstra_single_pair(sg, s, t, true));
+      }
+    }
+  }
+}
+
+#ifdef APSP_STATS
+TEST(SinglePairDijkstraTests, SmallerSearchTest) {
+  AdjacencyList<int> g(900, true);
+  load_edges(g, generate_grid(30, 30, 6));
+  StaticGraph sg(g);
+  AlgorithmStats full, unidirectional, bidirectional;
+  for (int s = 0; s < 900; s += 97) {
+    GraphAlgorithms<int>::johnsons_query(g, vector<int>(900, 0), s, &full);
+    GraphAlgorithms<int>::dijkstra_single_pair(sg, s, s / 2 + 300, false, &unidirectional);
+    GraphAlgorithms<int>::dijkstra_single_pair(sg, s, s / 2 + 300, true, &bidirectional);
+  }
+  ASSERT_LT(unidirectional.heap_pops, full.heap_pops);
+  ASSERT_LT(bidirectional.heap_pops, unidirectional.heap_pops);
+}
+#endif
+
+//----------------------------------------------------------------------
+// Many To Many Tests
+//----------------------------------------------------------------------
+
+TEST(ManyToManyTests, SmallDirectedTest) {
+  AdjacencyList<int> g(4, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, -2, 2);
+  g.add_edge(0, 6, 2);
+  g.add_edge(2, 1, 3);
+  auto table = GraphAlgorithms<int>::many_to_many(g, {0, 3, 7}, {3, 2, 0, 2});
+  const int inf = std::numeric_limits<int>::max();
+  ASSERT_EQ(3, table.size());
+  ASSERT_EQ(vector<int>({0, -1, 0, -1}), table[0]);
+  ASSERT_EQ(vector<int>({0, inf, inf, inf}), table[1]);
+  ASSERT_EQ(vector<int>({inf, inf, inf, inf}), table[2]);
+}
+
+TEST(ManyToManyTests, NegativeCycleTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, -2, 0);
+  ASSERT_EQ(0, GraphAlgorithms<int>::many_to_many(g, {0}, {1}).size());
+}
+
+TEST(ManyToManyTests, MatchesJohnsonsTest) {
+  vector<AdjacencyList<int>> graphs = test_graphs(true);
+  vector<int> sources = {5, 17, 17, 99, 0};
+  vector<int> targets = {1, 2, 3, 50, 98, 64, 32, 5};
+  for (const auto& g : graphs) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    auto table = GraphAlgorithms<int>::many_to_many(g, sources, targets);
+    ASSERT_EQ(sources.size(), table.size());
+    for (size_t i = 0; i < sources.size(); i++)
+      for (size_t j = 0; j < targets.size(); j++)
+        ASSERT_EQ(expected[sources[i]][targets[j]], table[i][j]);
+  }
+}
+
+//----------------------------------------------------------------------
+// Condensation Tests
+//----------------------------------------------------------------------
+
+TEST(CondensationTests, ComponentsTest) {
+  // {0,1,2} -> {3} -> {4,5}, plus an isolated 6
+  AdjacencyList<int> g(7, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, 1, 2);
+  g.add_edge(2, 1, 0);
+  g.add_edge(2, 1, 3);
+  g.add_edge(3, 1, 4);
+  g.add_edge(4, 1, 5);
+  g.add_edge(5, 1, 4);
+  auto component = GraphAlgorithms<int>::strongly_connected_components(g);
+  ASSERT_EQ(7, component.size());
+  ASSERT_EQ(component[0], component[1]);
+  ASSERT_EQ(component[0], component[2]);
+  ASSERT_EQ(component[4], component[5]);
+  set<int> distinct(component.begin(), component.end());
+  ASSERT_EQ(4, distinct.size());
+  ASSERT_LT(component[0], component[3]);
+  ASSERT_LT(component[3], component[4]);
+}
+
+TEST(CondensationTests, DeepPathTest) {
+  // long enough to overflow a recursive implementation's stack
+  int n = 200000;
+  AdjacencyList<int> g(n, true);
+  for (int x = 0; x < n - 1; x++)
+    g.add_edge(x, 1, x + 1);
+  g.add_edge(n - 1, 1, 0);
+  auto component = GraphAlgorithms<int>::strongly_connected_components(g);
+  ASSERT_EQ(set<int>({0}), set<int>(component.begin(), component.end()));
+}
+
+TEST(CondensationTests, AcyclicMatchesJohnsonsTest) {
+  AdjacencyList<int> g1(60, true);
+  load_sparse_acyclic_bipartite(g1);
+  AdjacencyList<int> g2(60, true);
+  load_dense(g2, 0.25);
+  // negative labels are fine without cycles
+  AdjacencyList<int> g3(5, true);
+  g3.add_edge(3, -4, 1);
+  g3.add_edge(1, 2, 0);
+  g3.add_edge(3, 1, 0);
+  g3.add_edge(0, -1, 4);
+  for (const Graph<int>* g : {(Graph<int>*) &g1, (Graph<int>*) &g2, (Graph<int>*) &g3})
+    ASSERT_EQ(GraphAlgorithms<int>::johnsons(*g), GraphAlgorithms<int>::condensed_apsp(*g));
+}
+
+TEST(CondensationTests, CyclicMatchesJohnsonsTest) {
+  // a sparser R-MAT graph has more components
+  vector<AdjacencyList<int>> graphs = test_graphs(true);
+  graphs.emplace_back(100, true);
+  load_edges(graphs.back(), generate_rmat(100, 150, 3, true));
+  graphs.emplace_back(60, true);
+  load_sparse_mini_cycles(graphs.back());
+  for (const auto& g : graphs)
+    ASSERT_EQ(GraphAlgorithms<int>::johnsons(g), GraphAlgorithms<int>::condensed_apsp(g));
+}
+
+TEST(CondensationTests, NegativeCycleTest) {
+  AdjacencyList<int> g(4, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, 1, 2);
+  g.add_edge(2, -3, 1);
+  g.add_edge(2, 1, 3);
+  ASSERT_EQ(0, GraphAlgorithms<int>::condensed_apsp(g).size());
+  AdjacencyList<int> loop(2, true);
+  loop.add_edge(0, 1, 1);
+  loop.add_edge(1, -1, 1);
+  ASSERT_EQ(0, GraphAlgorithms<int>::condensed_apsp(loop).size());
+}
+
+//----------------------------------------------------------------------
+// Partitioned APSP Tests
+//----------------------------------------------------------------------
+
+TEST(PartitionedApspTests, LabelPropagationTest) {
+  AdjacencyList<int> g(120, true);
+  load_blocks(g);
+  auto clusters = GraphAlgorithms<int>::label_propagation_clusters(g);
+  ASSERT_EQ(120, clusters.size());
+  // every region ends up in clusters of its own
+  for (int x = 0; x < 120; x++) {
+    for (int y = 0; y < 120; y++) {
+      if (x / 40 != y / 40) {
+        ASSERT_NE(clusters[x], clusters[y]);
+      }
+    }
+  }
+}
+
+TEST(PartitionedApspTests, MatchesJohnsonsTest) {
+  AdjacencyList<int> g(120, true);
+  load_blocks(g);
+  auto expected = GraphAlgorithms<int>::johnsons(g);
+  ASSERT_EQ(expected, GraphAlgorithms<int>::partitioned_apsp(g));
+  ASSERT_EQ(expected, GraphAlgorithms<int>::partitioned_apsp(g, {}, 4));
+  // user partition by region, with arbitrary ids
+  vector<int> regions;
+  for (int x = 0; x < 120; x++)
+    regions.push_back(100 - 7 * (x / 40));
+  ASSERT_EQ(expected, GraphAlgorithms<int>::partitioned_apsp(g, regions, 2));
+}
+
+TEST(PartitionedApspTests, UserPartitionTest) {
+  for (const auto& g : test_graphs(true)) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    // rows of the grid, a single cluster, and every vertex alone
+    vector<int> rows, single(100, 0), alone;
+    for (int x = 0; x < 100; x++) {
+      rows.push_back(x / 10);
+      alone.push_back(x);
+    }
+    ASSERT_EQ(expected, GraphAlgorithms<int>::partitioned_apsp(g, rows));
+    ASSERT_EQ(expected, GraphAlgorithms<int>::partitioned_apsp(g, single));
+    ASSERT_EQ(expected, GraphAlgorithms<int>::partitioned_apsp(g, alone));
+    ASSERT_EQ(expected, GraphAlgorithms<int>::partitioned_apsp(g));
+  }
+}
+
+TEST(PartitionedApspTests, NegativeCycleTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, -2, 0);
+  ASSERT_EQ(0, GraphAlgorithms<int>::partitioned_apsp(g).size());
+}
+
+TEST(PartitionedApspTests, WrongClusterCountTest) {
+  AdjacencyList<int> g(120, true);
+  load_blocks(g);
+  // a partition of the wrong length is rejected, not replaced
+  ASSERT_EQ(0, GraphAlgorithms<int>::partitioned_apsp(g, vector<int>(119, 0)).size());
+  ASSERT_EQ(0, GraphAlgorithms<int>::partitioned_apsp(g, vector<int>(121, 0)).size());
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(g), GraphAlgorithms<int>::partitioned_apsp(g, vector<int>(120, 0)));
+}
+
+//----------------------------------------------------------------------
+// Process Floyd-Warshall Tests
+//----------------------------------------------------------------------
+
+TEST(ProcessFloydWarshallTests, MatchesJohnsonsTest) {
+  // plus a node count none of the tile sizes divide
+  vector<AdjacencyList<int>> graphs = test_graphs(true);
+  graphs.emplace_back(97, false);
+  load_edges(graphs.back(), generate_geometric(97, 0.2, 4));
+  for (const auto& g : graphs) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    ASSERT_EQ(expected, process_floyd_warshall(g, 1, 32));
+    ASSERT_EQ(expected, process_floyd_warshall(g, 4, 16));
+    ASSERT_EQ(expected, process_floyd_warshall(g, 6, 10));
+    ASSERT_EQ(expected, process_floyd_warshall(g, 3, 200));
+  }
+}
+
+TEST(ProcessFloydWarshallTests, NegativeCycleTest) {
+  AdjacencyList<int> g(40, true);
+  load_sparse(g);
+  g.add_edge(30, -1000, 29);
+  ASSERT_EQ(0, process_floyd_warshall(g, 4, 8).size());
+}
+
+TEST(ProcessFloydWarshallTests, DeadWorkerTest) {
+  AdjacencyList<int> g(600, true);
+  load_edges(g, generate_rmat(600, 6000, 7));
+  // kill a worker as soon as this thread has forked it
+  std::string children = "/proc/self/task/" + std::to_string(gettid()) + "/children";
+  std::atomic<bool> done = false;
+  std::thread killer([&] {
+    while (!done) {
+      std::ifstream in(children);
+      pid_t pid;
+      if (in >> pid) {
+        kill(pid, SIGKILL);
+        return;
+      }
+      std::this_thread::yield();
+    }
+  });
+  // the other workers stop instead of waiting for it
+  auto dists = process_floyd_warshall(g, 4, 50);
+  done = true;
+  killer.join();
+  ASSERT_EQ(0, dists.size());
+  // and the next run is unaffected
+  AdjacencyList<int> small(30, true);
+  load_sparse(small);
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(small), process_floyd_warshall(small, 4, 8));
+}
+
+#ifdef APSP_STATS
+TEST(ProcessFloydWarshallTests, StatsTest) {
+  AdjacencyList<int> g(20, true);
+  load_sparse(g);
+  AlgorithmStats stats;
+  process_floyd_warshall(g, 4, 5, &stats);
+  ASSERT_EQ(20, stats.pivot_phases);
+  ASSERT_LT(0, stats.relaxations);
+  ASSERT_LT(0, stats.successful_relaxations);
+}
+#endif
+
+//----------------------------------------------------------------------
+// Compressed Matrix Tests
+//----------------------------------------------------------------------
+
+TEST(CompressedMatrixTests, EmptyTest) {
+  CompressedMatrix m;
+  ASSERT_EQ(0, m.rows());
+  ASSERT_EQ(0, m.cols());
+  ASSERT_EQ(0, m.row(0).size());
+  ASSERT_EQ(0, m.decompress().size());
+}
+
+TEST(CompressedMatrixTests, RoundTripTest) {
+  const int inf = std::numeric_limits<int>::max();
+  const int low = std::numeric_limits<int>::min();
+  vector<vector<int>> matrix = {
+    {0, 5, inf, inf, inf, -3},
+    {inf, inf, inf, inf, inf, inf},
+    {low, inf - 1, low, 0, inf, inf - 1},
+    {1, 2, 3, 4, 5, 6}
+  };
+  CompressedMatrix m(matrix);
+  ASSERT_EQ(4, m.rows());
+  ASSERT_EQ(6, m.cols());
+  ASSERT_EQ(matrix, m.decompress());
+  // rows decode on their own, in any order
+  ASSERT_EQ(matrix[3], m.row(3));
+  ASSERT_EQ(matrix[1], m.row(1));
+  vector<int> r;
+  ASSERT_TRUE(m.row(2, r));
+  ASSERT_EQ(matrix[2], r);
+  ASSERT_FALSE(m.row(4, r));
+  ASSERT_FALSE(m.row(-1, r));
+}
+
+TEST(CompressedMatrixTests, DistanceMatrixTest) {
+  AdjacencyList<int> g(400, true);
+  load_edges(g, generate_grid(20, 20, 2, true));
+  auto dists = GraphAlgorithms<int>::johnsons(g);
+  CompressedMatrix m(dists);
+  ASSERT_EQ(dists, m.decompress());
+  // neighbouring grid distances differ by small amounts
+  ASSERT_LT(m.byte_size() * 2, dists.size() * dists.size() * sizeof(int));
+}
+
+TEST(CompressedMatrixTests, ReadWriteTest) {
+  AdjacencyList<int> g(50, true);
+  load_edges(g, generate_rmat(50, 100, 7));
+  auto dists = GraphAlgorithms<int>::johnsons(g);
+  CompressedMatrix m(dists);
+  std::stringstream out;
+  ASSERT_TRUE(m.write(out));
+  CompressedMatrix copy;
+  ASSERT_TRUE(copy.read(out));
+  ASSERT_EQ(dists, copy.decompress());
+}
+
+TEST(CompressedMatrixTests, CorruptSizesTest) {
+  // a huge column count and row size with only a few bytes behind them
+  // are rejected without allocating for them
+  auto bytes = [](std::initializer_list<uint64_t> values) {
+    vector<uint8_t> data = {'A', 'P', 'S', 'M'};
+    for (uint64_t value : values)
+      compressed_matrix::put_varint(data, value);
+    return std::string(data.begin(), data.end());
+  };
+  uint64_t cols = std::numeric_limits<int>::max();
+  CompressedMatrix m;
+  std::stringstream header_only(bytes({cols}) + "x");
+  ASSERT_FALSE(m.read(header_only));
+  std::stringstream huge_row(bytes({cols, 10 * cols + 1}) + "abc");
+  ASSERT_FALSE(m.read(huge_row));
+  ASSERT_EQ(0, m.rows());
+  // while a short row can still cover every column
+  std::stringstream one_run(bytes({cols, 6, ((cols - 1) << 1) | 1, 0, 1}));
+  ASSERT_TRUE(m.read(one_run));
+  ASSERT_EQ(1, m.rows());
+  ASSERT_EQ(cols, m.cols());
+}
+
+TEST(CompressedMatrixTests, WriterTest) {
+  AdjacencyList<int> g(50, true);
+  load_edges(g, generate_grid(5, 10, 3, true));
+  auto dists = GraphAlgorithms<int>::johnsons(g);
+  std::stringstream streamed, written;
+  CompressedMatrixWriter writer(streamed, 50);
+  for (const auto& row : dists) {
+    ASSERT_TRUE(writer.write_row(row));
+  }
+  ASSERT_FALSE(writer.write_row(vector<int>(49, 0)));
+  ASSERT_TRUE(writer.finish());
+  ASSERT_FALSE(writer.write_row(dists[0]));
+  ASSERT_EQ(50, writer.rows());
+  ASSERT_EQ(streamed.str().size(), writer.bytes_written());
+  // the same bytes as writing the whole matrix
+  CompressedMatrix(dists).write(written);
+  ASSERT_EQ(written.str(), streamed.str());
+  CompressedMatrix copy;
+  ASSERT_TRUE(copy.read(streamed));
+  ASSERT_EQ(dists, copy.decompress());
+}
+
+TEST(CompressedMatrixTests, BadReadTest) {
+  vector<vector<int>> matrix = {{0, 1}, {2, 0}};
+  std::stringstream out;
+  CompressedMatrix(matrix).write(out);
+  std::string bytes = out.str();
+  // truncated, a bad magic, and a bad row count
+  std::string truncated = bytes.substr(0, bytes.size() - 2);
+  std::string magic = bytes;
+  magic[0] = 'X';
+  std::string count = bytes;
+  count.back() = 3;
+  for (const std::string& bad : {truncated, magic, count, std::string()}) {
+    std::stringstream in(bad);
+    CompressedMatrix m(matrix);
+    ASSERT_FALSE(m.read(in));
+    ASSERT_EQ(0, m.rows());
+  }
+}
+
+//----------------------------------------------------------------------
+// Johnson's Stream Tests
+//----------------------------------------------------------------------
+
+TEST(JohnsonsStreamTests, CallbackTest) {
+  for (const auto& g : test_graphs(true)) {
+    vector<vector<int>> rows;
+    const int* buffer = nullptr;
+    bool reused = true;
+    ASSERT_TRUE(GraphAlgorithms<int>::johnsons_stream(g, [&](int source, const vector<int>& row) {
+      ASSERT_EQ(rows.size(), source);
+      reused = reused && (buffer == nullptr || buffer == row.data());
+      buffer = row.data();
+      rows.push_back(row);
+    }));
+    ASSERT_TRUE(reused);
+    ASSERT_EQ(GraphAlgorithms<int>::johnsons(g), rows);
+  }
+}
+
+TEST(JohnsonsStreamTests, NegativeCycleTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, -2, 0);
+  int calls = 0;
+  ASSERT_FALSE(GraphAlgorithms<int>::johnsons_stream(g, [&](int, const vector<int>&) { calls++; }));
+  ASSERT_EQ(0, calls);
+  RowQueue queue;
+  ASSERT_FALSE(GraphAlgorithms<int>::johnsons_stream(g, queue));
+  ASSERT_TRUE(queue.closed());
+}
+
+TEST(JohnsonsStreamTests, QueueTest) {
+  AdjacencyList<int> g(200, true);
+  load_edges(g, generate_rmat(200, 800, 5));
+  RowQueue queue(2);
+  vector<vector<int>> rows;
+  std::thread consumer([&] {
+    int source;
+    vector<int> row;
+    while (queue.pop(source, row)) {
+      rows.resize(source + 1);
+      rows[source] = row;
+    }
+  });
+  ASSERT_TRUE(GraphAlgorithms<int>::johnsons_stream(g, queue));
+  consumer.join();
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(g), rows);
+}
+
+TEST(JohnsonsStreamTests, QueueCloseTest) {
+  AdjacencyList<int> g(100, true);
+  load_sparse(g);
+  RowQueue queue(1);
+  int taken = 0;
+  std::thread consumer([&] {
+    int source;
+    vector<int> row;
+    while (taken < 10 && queue.pop(source, row)) {
+      taken++;
+    }
+    queue.close();
+  });
+  ASSERT_FALSE(GraphAlgorithms<int>::johnsons_stream(g, queue));
+  consumer.join();
+  ASSERT_EQ(10, taken);
+}
+
+TEST(JohnsonsStreamTests, CompressedWriterTest) {
+  AdjacencyList<int> g(100, true);
+  load_edges(g, generate_grid(10, 10, 2, true));
+  std::stringstream streamed, expected;
+  CompressedMatrixWriter writer(streamed, g.node_count());
+  ASSERT_TRUE(GraphAlgorithms<int>::johnsons_stream(g, [&](int, const vector<int>& row) {
+    writer.write_row(row);
+  }));
+  ASSERT_TRUE(writer.finish());
+  CompressedMatrix(GraphAlgorithms<int>::johnsons(g)).write(expected);
+  ASSERT_EQ(expected.str(), streamed.str());
+}
+
+#ifdef APSP_STATS
+TEST(JohnsonsStreamTests, StatsTest) {
+  AdjacencyList<int> g(200, true);
+  load_sparse(g);
+  AlgorithmStats streamed, full;
+  GraphAlgorithms<int>::johnsons_stream(g, [](int, const vector<int>&) {}, &streamed);
+  GraphAlgorithms<int>::johnsons(g, &full);
+  ASSERT_EQ(full.relaxations, streamed.relaxations);
+  ASSERT_EQ(full.heap_pops, streamed.heap_pops);
+  // one row of buffers instead of one per source
+  ASSERT_LT(streamed.bytes_allocated * 50, full.bytes_allocated);
+}
+#endif
+
+//----------------------------------------------------------------------
+// Symmetric APSP Tests
+//----------------------------------------------------------------------
+
+TEST(SymmetricApspTests, MatrixTest) {
+  SymmetricMatrix m(4);
+  ASSERT_EQ(4, m.size());
+  ASSERT_EQ(10, m.packed().size());
+  m.at(1, 3) = 7;
+  m.at(2, 0) = 5;
+  ASSERT_EQ(7, m.at(3, 1));
+  ASSERT_EQ(5, m.at(0, 2));
+  ASSERT_EQ(std::numeric_limits<int>::max(), m.at(2, 3));
+  vector<int> row = m.row(3);
+  ASSERT_EQ(7, row[1]);
+  auto full = m.to_full();
+  ASSERT_EQ(4, full.size());
+  ASSERT_EQ(row, full[3]);
+  ASSERT_EQ(5, full[2][0]);
+}
+
+TEST(SymmetricApspTests, MatchesJohnsonsTest) {
+  vector<AdjacencyList<int>> graphs = test_graphs(false, true);
+  graphs[1].add_edge(5, 0, 5);
+  for (const auto& g : graphs) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    ASSERT_EQ(expected, GraphAlgorithms<int>::symmetric_floyd_warshall(g).to_full());
+    ASSERT_EQ(expected, GraphAlgorithms<int>::symmetric_apsp(g).to_full());
+  }
+}
+
+TEST(SymmetricApspTests, RejectedGraphTest) {
+  AdjacencyList<int> directed(3, true);
+  directed.add_edge(0, 1, 1);
+  ASSERT_EQ(0, GraphAlgorithms<int>::symmetric_floyd_warshall(directed).size());
+  ASSERT_EQ(0, GraphAlgorithms<int>::symmetric_apsp(directed).size());
+  // a negative undirected edge is a negative cycle
+  AdjacencyList<int> negative(3, false);
+  negative.add_edge(0, 1, 1);
+  negative.add_edge(1, -1, 2);
+  ASSERT_EQ(0, GraphAlgorithms<int>::symmetric_floyd_warshall(negative).size());
+  ASSERT_EQ(0, GraphAlgorithms<int>::symmetric_apsp(negative).size());
+}
+
+#ifdef APSP_STATS
+TEST(SymmetricApspTests, StatsTest) {
+  AdjacencyList<int> g(40, false);
+  load_edges(g, generate_grid(5, 8, 2));
+  AlgorithmStats symmetric, full;
+  GraphAlgorithms<int>::symmetric_floyd_warshall(g, &symmetric);
+  GraphAlgorithms<int>::floyd_warshall(g, &full);
+  ASSERT_EQ(40, symmetric.pivot_phases);
+  // at most the upper triangle is relaxed in each phase
+  ASSERT_GE(40 * 40 * 41 / 2, symmetric.relaxations);
+  ASSERT_EQ(40 * 40 * 40, full.relaxations);
+  // the later dijkstra sources stop early
+  AlgorithmStats dijkstra, johnsons;
+  GraphAlgorithms<int>::symmetric_apsp(g, &dijkstra);
+  GraphAlgorithms<int>::johnsons(g, &johnsons);
+  ASSERT_LT(dijkstra.heap_pops, johnsons.heap_pops);
+}
+#endif
+
+//----------------------------------------------------------------------
+// Bit-Parallel APSP Tests
+//----------------------------------------------------------------------
+
+TEST(BitParallelApspTests, UniformLabelTest) {
+  AdjacencyList<int> g(4, true);
+  ASSERT_EQ(1, GraphAlgorithms<int>::uniform_edge_label(g));
+  g.add_edge(0, 3, 1);
+  g.add_edge(1, 3, 2);
+  ASSERT_EQ(3, GraphAlgorithms<int>::uniform_edge_label(g));
+  g.add_edge(2, 4, 3);
+  ASSERT_EQ(-1, GraphAlgorithms<int>::uniform_edge_label(g));
+  AdjacencyList<int> negative(2, true);
+  negative.add_edge(0, -1, 1);
+  ASSERT_EQ(-1, GraphAlgorithms<int>::uniform_edge_label(negative));
+  ASSERT_EQ(0, GraphAlgorithms<int>::bit_parallel_apsp(negative).size());
+}
+
+TEST(BitParallelApspTests, MatchesJohnsonsTest) {
+  // more than one batch of sources, unit and other uniform labels,
+  // directed and undirected
+  vector<AdjacencyList<int>> graphs;
+  for (int label : {1, 7, 0}) {
+    for (bool undirected : {false, true}) {
+      for (const auto& base : test_graphs(false, undirected, 25)) {
+        graphs.emplace_back(base.node_count(), base.is_directed());
+        for (int x = 0; x < base.node_count(); x++) {
+          for (int y : base.out_nodes(x)) {
+            graphs.back().add_edge(x, label, y);
+          }
+        }
+      }
+    }
+  }
+  for (const auto& g : graphs) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    ASSERT_EQ(expected, GraphAlgorithms<int>::bit_parallel_apsp(g, 1));
+    ASSERT_EQ(expected, GraphAlgorithms<int>::bit_parallel_apsp(g, 3));
+  }
+}
+
+TEST(BitParallelApspTests, EmptyGraphTest) {
+  AdjacencyList<int> g(0, true);
+  ASSERT_EQ(0, GraphAlgorithms<int>::bit_parallel_apsp(g).size());
+  AdjacencyList<int> single(1, true);
+  ASSERT_EQ(vector<vector<int>>({{0}}), GraphAlgorithms<int>::bit_parallel_apsp(single));
+}
+
+//----------------------------------------------------------------------
+// Checkpoint Tests
+//----------------------------------------------------------------------
+
+// a checkpoint file name unique to the test
+std::string checkpoint_path(const std::string& name) {
+  std::string path = "/tmp/final_test_" + name + ".ckpt";
+  std::remove(path.c_str());
+  return path;
+}
+
+TEST(CheckpointTests, FingerprintTest) {
+  AdjacencyList<int> g1(3, true), g2(3, true), g3(3, true), g4(3, false);
+  g1.add_edge(0, 5, 1);
+  g1.add_edge(0, 2, 2);
+  g2.add_edge(0, 2, 2);
+  g2.add_edge(0, 5, 1);
+  g3.add_edge(0, 5, 1);
+  g3.add_edge(0, 3, 2);
+  g4.add_edge(0, 5, 1);
+  g4.add_edge(0, 2, 2);
+  ASSERT_EQ(checkpoint::fingerprint(g1), checkpoint::fingerprint(g2));
+  ASSERT_NE(checkpoint::fingerprint(g1), checkpoint::fingerprint(g3));
+  ASSERT_NE(checkpoint::fingerprint(g1), checkpoint::fingerprint(g4));
+}
+
+TEST(CheckpointTests, FloydWarshallNegativeCycleTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, -2, 0);
+  std::string path = checkpoint_path("fw_negative");
+  ASSERT_EQ(0, checkpointed_floyd_warshall(g, path).size());
+  std::remove(path.c_str());
+}
+
+TEST(CheckpointTests, UnwritablePathTest) {
+  AdjacencyList<int> g(50, true);
+  load_edges(g, generate_rmat(50, 200, 3, true));
+  auto expected = GraphAlgorithms<int>::johnsons(g);
+  // the run still finishes, but reports the lost checkpoints
+  std::string missing = checkpoint_path("missing") + "/dir/file";
+  bool ok = true;
+  ASSERT_EQ(expected, checkpointed_floyd_warshall(g, missing, 5, nullptr, &ok));
+  ASSERT_FALSE(ok);
+  ok = true;
+  ASSERT_EQ(expected, checkpointed_johnsons(g, missing, 5, nullptr, &ok));
+  ASSERT_FALSE(ok);
+  ASSERT_FALSE(std::filesystem::exists(missing));
+  std::string path = checkpoint_path("writable");
+  ASSERT_EQ(expected, checkpointed_johnsons(g, path, 5, nullptr, &ok));
+  ASSERT_TRUE(ok);
+  ok = false;
+  ASSERT_EQ(expected, checkpointed_floyd_warshall(g, path + ".fw", 5, nullptr, &ok));
+  ASSERT_TRUE(ok);
+  std::remove(path.c_str());
+  std::remove((path + ".fw").c_str());
+}
+
+#ifdef APSP_STATS
+TEST(CheckpointTests, FloydWarshallTest) {
+  AdjacencyList<int> g(60, true);
+  load_edges(g, generate_rmat(60, 240, 3, true));
+  auto expected = GraphAlgorithms<int>::johnsons(g);
+  std::string path = checkpoint_path("fw");
+  AlgorithmStats first, again;
+  ASSERT_EQ(expected, checkpointed_floyd_warshall(g, path, 7, &first));
+  ASSERT_EQ(60, first.pivot_phases);
+  // the finished run is left in the file
+  ASSERT_EQ(expected, checkpointed_floyd_warshall(g, path, 7, &again));
+  ASSERT_EQ(0, again.pivot_phases);
+  std::remove(path.c_str());
+}
+
+TEST(CheckpointTests, FloydWarshallResumeTest) {
+  AdjacencyList<int> g(40, true);
+  load_sparse(g);
+  auto expected = GraphAlgorithms<int>::johnsons(g);
+  std::string path = checkpoint_path("fw_resume");
+  // the state after 25 pivots (any table of path costs that already
+  // accounts for those pivots will do)
+  vector<int> matrix;
+  for (const auto& row : expected) {
+    matrix.insert(matrix.end(), row.begin(), row.end());
+  }
+  ASSERT_TRUE(checkpoint::write_floyd_warshall(path, checkpoint::fingerprint(g), 40, 25, matrix));
+  AlgorithmStats stats;
+  ASSERT_EQ(expected, checkpointed_floyd_warshall(g, path, 100, &stats));
+  ASSERT_EQ(15, stats.pivot_phases);
+
+  // a checkpoint for another graph is ignored
+  vector<int> zeros(40 * 40, 0);
+  ASSERT_TRUE(checkpoint::write_floyd_warshall(path, checkpoint::fingerprint(g) + 1, 40, 25, zeros));
+  ASSERT_EQ(expected, checkpointed_floyd_warshall(g, path, 100));
+  std::remove(path.c_str());
+}
+
+TEST(CheckpointTests, JohnsonsResumeTest) {
+  AdjacencyList<int> g(100, true);
+  load_edges(g, generate_grid(10, 10, 2, true));
+  auto expected = GraphAlgorithms<int>::johnsons(g);
+  std::string path = checkpoint_path("johnsons");
+  AlgorithmStats full;
+  ASSERT_EQ(expected, checkpointed_johnsons(g, path, 16, &full));
+
+  // cut the file to 30 rows and part of the next, as if the run had
+  // been stopped while writing
+  long long header = 4 + 8 + 4 + 100 * sizeof(int);
+  std::filesystem::resize_file(path, header + 30 * 100 * sizeof(int) + 10);
+  AlgorithmStats resumed;
+  ASSERT_EQ(expected, checkpointed_johnsons(g, path, 16, &resumed));
+  ASSERT_EQ(0, resumed.bellman_ford_rounds);
+  ASSERT_LT(resumed.heap_pops, full.heap_pops);
+  ASSERT_EQ(header + 100 * 100 * sizeof(int), std::filesystem::file_size(path));
+
+  // a changed graph starts over
+  g.set_label(0, 1000, 1);
+  AlgorithmStats changed;
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(g), checkpointed_johnsons(g, path, 16, &changed));
+  ASSERT_LT(0, changed.bellman_ford_rounds);
+  std::remove(path.c_str());
+}
+#endif
+
+//----------------------------------------------------------------------
+// Vertex Order Tests
+//----------------------------------------------------------------------
+
+// a grid with its vertices shuffled
+AdjacencyList<int> shuffled_grid(int side, bool directed) {
+  vector<int> ids(side * side);
+  for (int x = 0; x < side * side; x++) {
+    ids[x] = (x * 7919) % (side * side);
+  }
+  AdjacencyList<int> g(side * side, directed);
+  for (const auto& [x, label, y] : generate_grid(side, side, 3)) {
+    g.add_edge(ids[x], label, ids[y]);
+  }
+  return g;
+}
+
+TEST(VertexOrderTests, PermutationTest) {
+  AdjacencyList<int> g = shuffled_grid(10, true);
+  for (auto ordering : {VertexOrdering::rcm, VertexOrdering::bfs, VertexOrdering::degree}) {
+    VertexOrder order(g, ordering);
+    ASSERT_EQ(100, order.node_count());
+    set<int> ids;
+    for (int x = 0; x < 100; x++) {
+      ASSERT_EQ(x, order.old_id(order.new_id(x)));
+      ids.insert(order.new_id(x));
+    }
+    ASSERT_EQ(100, ids.size());
+    AdjacencyList<int> permuted = order.permute(g);
+    ASSERT_EQ(g.edge_count(), permuted.edge_count());
+    for (int x = 0; x < 100; x++) {
+      for (const auto& [label, y] : g.out_edges(x)) {
+        ASSERT_EQ(label, permuted.get_label(order.new_id(x), order.new_id(y)));
+      }
+    }
+  }
+}
+
+TEST(VertexOrderTests, LocalityTest) {
+  AdjacencyList<int> g = shuffled_grid(20, false);
+  double before = VertexOrder::edge_span(g);
+  VertexOrder rcm(g, VertexOrdering::rcm);
+  VertexOrder bfs(g, VertexOrdering::bfs);
+  // a grid side is 20, so neighbors end up about 20 apart
+  ASSERT_GT(before, 50);
+  ASSERT_GE(20, VertexOrder::edge_span(rcm.permute(g)));
+  ASSERT_GE(20, VertexOrder::edge_span(bfs.permute(g)));
+}
+
+TEST(VertexOrderTests, ReorderedApspTest) {
+  vector<AdjacencyList<int>> graphs = test_graphs(true);
+  graphs.push_back(shuffled_grid(10, true));
+  for (const auto& g : graphs) {
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    for (auto ordering : {VertexOrdering::rcm, VertexOrdering::bfs, VertexOrdering::degree}) {
+      ASSERT_EQ(expected, reordered_apsp(g, ordering, [](const Graph<int>& p) {
+        return GraphAlgorithms<int>::johnsons(p);
+      }));
+    }
+  }
+  AdjacencyList<int> negative(3, true);
+  negative.add_edge(0, 1, 1);
+  negative.add_edge(1, -2, 0);
+  ASSERT_EQ(0, reordered_apsp(negative, VertexOrdering::rcm, [](const Graph<int>& p) {
+    return GraphAlgorithms<int>::johnsons(p);
+  }).size());
+}
+
+//----------------------------------------------------------------------
+// SnapshotGraph Tests
+//----------------------------------------------------------------------
+
+TEST(SnapshotGraphTests, PublishTest) {
+  SnapshotGraph g(4, true);
+  ASSERT_EQ(0, g.version());
+  g.add_edge(0, 5, 1);
+  g.add_edge(1, 2, 2);
+  ASSERT_EQ(2, g.pending_count());
+  {
+    auto before = g.pin();
+    ASSERT_EQ(0, before->edge_count());
+    ASSERT_EQ(1, g.publish());
+    // the old version is unchanged while it is pinned
+    ASSERT_EQ(0, before->edge_count());
+    ASSERT_FALSE(before->has_edge(0, 1));
+    ASSERT_EQ(0, before->version());
+    ASSERT_EQ(1, g.reclaim());
+  }
+  ASSERT_EQ(0, g.reclaim());
+  auto pinned = g.pin();
+  ASSERT_EQ(1, pinned->version());
+  ASSERT_EQ(2, pinned->edge_count());
+  ASSERT_EQ(5, pinned->get_label(0, 1));
+  ASSERT_EQ(vector<int>{0}, pinned->in_nodes(1));
+  // publishing with nothing queued keeps the version
+  ASSERT_EQ(1, g.publish());
+  g.set_label(0, 7, 1);
+  g.rem_edge(1, 2);
+  g.rem_edge(2, 3);
+  ASSERT_EQ(2, g.publish());
+  ASSERT_EQ(5, pinned->get_label(0, 1));
+  ASSERT_TRUE(pinned->has_edge(1, 2));
+  auto latest = g.pin();
+  ASSERT_EQ(7, latest->get_label(0, 1));
+  ASSERT_FALSE(latest->has_edge(1, 2));
+  ASSERT_EQ(1, latest->edge_count());
+}
+
+TEST(SnapshotGraphTests, UndirectedTest) {
+  AdjacencyList<int> start(3, false);
+  start.add_edge(0, 1, 1);
+  SnapshotGraph g(start);
+  g.add_edge(2, 4, 1);
+  g.set_label(1, 3, 0);
+  g.publish();
+  auto pinned = g.pin();
+  ASSERT_FALSE(pinned->is_directed());
+  ASSERT_EQ(2, pinned->edge_count());
+  ASSERT_EQ(3, pinned->get_label(0, 1));
+  ASSERT_EQ(3, pinned->get_label(1, 0));
+  ASSERT_EQ(4, pinned->get_label(1, 2));
+  auto dists = GraphAlgorithms<int>::dijkstra_shortest_path(pinned.graph(), 0);
+  ASSERT_EQ((vector<int>{0, 3, 7}), dists);
+}
+
+TEST(SnapshotGraphTests, ConcurrentReadersTest) {
+  // a ring 0 -> 1 -> ... -> n-1 -> 0 where the writer moves one unit of
+  // weight between two edges per version, so every version has the
+  // same total weight and each reader can check its snapshot
+  int n = 50;
+  AdjacencyList<int> ring(n, true);
+  for (int x = 0; x < n; x++) {
+    ring.add_edge(x, 10, (x + 1) % n);
+  }
+  SnapshotGraph g(ring);
+  std::atomic<bool> done(false);
+  std::atomic<int> bad(0);
+  std::atomic<int> queries(0);
+  vector<std::thread> readers;
+  for (int r = 0; r < 4; r++) {
+    readers.emplace_back([&] {
+      while (!done) {
+        auto pinned = g.pin();
+        auto dists = GraphAlgorithms<int>::dijkstra_shortest_path(pinned.graph(), 0);
+        int total = dists[n - 1] + *pinned->get_label(n - 1, 0);
+        if (total != 10 * n || pinned->edge_count() != n) {
+          bad++;
+        }
+        queries++;
+      }
+    });
+  }
+  for (int v = 0; v < 200; v++) {
+    int x = v % (n - 1);
+    int a = *g.pin()->get_label(x, x + 1);
+    int b = *g.pin()->get_label(x + 1, (x + 2) % n);
+    if (a > 1) {
+      g.set_label(x, a - 1, x + 1);
+      g.set_label(x + 1, b + 1, (x + 2) % n);
+    }
+    g.publish();
+    if (v % 50 == 0) {
+      std::this_thread::yield();
+    }
+  }
+  while (queries < 20) {
+    std::this_thread::yield();
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(0, bad);
+  ASSERT_EQ(200, g.version());
+  ASSERT_EQ(0, g.reclaim());
+}
+
+//----------------------------------------------------------------------
+// ApspScheduler Tests
+//----------------------------------------------------------------------
+
+TEST(ApspSchedulerTests, ResultTest) {
+  vector<AdjacencyList<int>> graphs = test_graphs(true);
+  graphs.emplace_back(0, true);
+  ApspScheduler scheduler(2);
+  ASSERT_EQ(2, scheduler.thread_count());
+  for (const auto& g : graphs) {
+    ApspJobOptions options;
+    ApspJob johnsons = scheduler.submit(g, options);
+    options.engine = ApspEngine::floyd_warshall;
+    options.priority = JobPriority::batch;
+    ApspJob floyd_warshall = scheduler.submit(g, options);
+    auto expected = GraphAlgorithms<int>::johnsons(g);
+    ASSERT_EQ(expected, johnsons.get());
+    ASSERT_EQ(expected, floyd_warshall.get());
+    ASSERT_TRUE(johnsons.done());
+    ASSERT_EQ(1.0, floyd_warshall.progress());
+    ASSERT_FALSE(johnsons.cancelled());
+  }
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(graphs[1]), scheduled_apsp(graphs[1]));
+}
+
+TEST(ApspSchedulerTests, NegativeCycleTest) {
+  AdjacencyList<int> g(3, true);
+  g.add_edge(0, 1, 1);
+  g.add_edge(1, -2, 0);
+  ApspScheduler scheduler(1);
+  for (auto engine : {ApspEngine::johnsons, ApspEngine::floyd_warshall}) {
+    ApspJobOptions options;
+    options.engine = engine;
+    ASSERT_EQ(0, scheduler.submit(g, options).get().size());
+  }
+}
+
+TEST(ApspSchedulerTests, ErrorTest) {
+  // the engines take value() of each label, so an unlabeled edge throws
+  // in the job and get rethrows it, as the synchronous call would
+  AdjacencyList<int> g(2, true);
+  g.add_edge(0, nullopt, 1);
+  ASSERT_THROW(GraphAlgorithms<int>::floyd_warshall(g), std::bad_optional_access);
+  ApspScheduler scheduler(1);
+  for (auto engine : {ApspEngine::johnsons, ApspEngine::floyd_warshall}) {
+    ApspJobOptions options;
+    options.engine = engine;
+    ApspJob job = scheduler.submit(g, options);
+    ASSERT_THROW(job.get(), std::bad_optional_access);
+    ASSERT_TRUE(job.done());
+  }
+  ASSERT_EQ(0, scheduler.pending_count());
+  // the workers carry on with later jobs
+  AdjacencyList<int> ok(2, true);
+  ok.add_edge(0, 3, 1);
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(ok), scheduler.submit(ok).get());
+}
+
+TEST(ApspSchedulerTests, SnapshotTest) {
+  // a job on a pinned snapshot shares its edge lists, which stay valid
+  // after the version is replaced and reclaimed
+  AdjacencyList<int> g(200, true);
+  load_edges(g, generate_rmat(200, 1000, 16, true));
+  auto expected = GraphAlgorithms<int>::johnsons(g);
+  SnapshotGraph versions(g);
+  ApspScheduler scheduler(1);
+  ApspJob job;
+  {
+    auto pinned = versions.pin();
+    job = scheduler.submit(pinned.graph());
+  }
+  for (int x = 0; x < 200; x++) {
+    versions.rem_edge(x, (x + 1) % 200);
+    versions.add_edge(x, 1, (x + 1) % 200);
+  }
+  versions.publish();
+  ASSERT_EQ(0, versions.reclaim());
+  ASSERT_EQ(expected, job.get());
+}
+
+#ifdef APSP_STATS
+TEST(ApspSchedulerTests, PotentialStepsTest) {
+  // the potentials are split into steps of Bellman-Ford rounds but do
+  // the same work as johnsons_prepare; on a path of negative edges
+  // toward 0 a round only moves one node further, so they take about
+  // 2000 rounds, more than one step
+  AdjacencyList<int> g(2000, true);
+  for (int x = 1; x < 2000; x++) {
+    g.add_edge(x, -1, x - 1);
+  }
+  AlgorithmStats expected, scheduled;
+  auto dists = GraphAlgorithms<int>::johnsons(g, &expected);
+  ApspScheduler scheduler(1);
+  ApspJobOptions options;
+  options.stats = &scheduled;
+  ASSERT_EQ(dists, scheduler.submit(g, options).get());
+  ASSERT_LT(1000, expected.bellman_ford_rounds);
+  ASSERT_EQ(expected.bellman_ford_rounds, scheduled.bellman_ford_rounds);
+  ASSERT_EQ(expected.relaxations, scheduled.relaxations);
+  ASSERT_EQ(expected.successful_relaxations, scheduled.successful_relaxations);
+  ASSERT_EQ(expected.heap_pops, scheduled.heap_pops);
+  ASSERT_EQ(expected.bytes_allocated, scheduled.bytes_allocated);
+}
+#endif
+
+TEST(ApspSchedulerTests, PriorityTest) {
+  // one worker: the small interactive job runs between the steps of
+  // the large batch job instead of after it
+  AdjacencyList<int> large(600, true);
+  load_edges(large, generate_rmat(600, 20000, 13, true));
+  AdjacencyList<int> small(10, true);
+  load_edges(small, generate_rmat(10, 30, 14, true));
+  ApspScheduler scheduler(1);
+  ApspJobOptions options;
+  options.engine = ApspEngine::floyd_warshall;
+  options.priority = JobPriority::batch;
+  ApspJob batch = scheduler.submit(large, options);
+  options.priority = JobPriority::interactive;
+  ApspJob interactive = scheduler.submit(small, options);
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(small), interactive.get());
+  ASSERT_FALSE(batch.done());
+  ASSERT_LT(batch.progress(), 1.0);
+  ASSERT_EQ(GraphAlgorithms<int>::johnsons(large), batch.get());
+  ASSERT_EQ(0, scheduler.pending_count());
+}
+
+TEST(ApspSchedulerTests, CancelTest) {
+  AdjacencyList<int> g(600, true);
+  load_edges(g, generate_rmat(600, 20000, 15, true));
+  ApspJobOptions options;
+  options.engine = ApspEngine::floyd_warshall;
+  ApspJob queued;
+  {
+    ApspScheduler scheduler(1);
+    ApspJob running = scheduler.submit(g, options);
+    ApspJob cancelled = scheduler.submit(g, options);
+    cancelled.cancel();
+    ASSERT_TRUE(cancelled.cancelled());
+    ASSERT_EQ(0, cancelled.get().size());
+    running.cancel();
+    ASSERT_EQ(0, running.get().size());
+    ASSERT_EQ(1.0, running.progress());
+    ASSERT_EQ(0, scheduler.pending_count());
+    // destroying the scheduler cancels the jobs it has not finished
+    queued = scheduler.submit(g, options);
+    scheduler.submit(g, options);
+  }
+  ASSERT_TRUE(queued.valid());
+  ASSERT_TRUE(queued.done());
+  ASSERT_EQ(0, queued.get().size());
+}
+
+//----------------------------------------------------------------------
+// SmallGraphBatch Tests
+//----------------------------------------------------------------------
+
+TEST(SmallGraphBatchTests, MatchesFloydWarshallTest) {
+  // every bucket, partly filled groups, and both directions
+  SmallGraphBatch batch;
+  vector<AdjacencyList<int>> graphs = test_graphs(true, false, 8);
+  for (int i = 0; i < 70; i++) {
+    int n = 1 + (i * 13) % 64;
+    bool directed = i % 3 != 0;
+    graphs.emplace_back(n, directed);
+    // negative labels (without negative cycles) only when directed
+    load_edges(graphs.back(), generate_rmat(n, 2 * n, 100 + i, directed, 50));
+  }
+  for (size_t i = 0; i < graphs.size(); i++) {
+    ASSERT_EQ(i, batch.add(graphs[i]));
+  }
+  batch.solve();
+  ASSERT_EQ(graphs.size(), batch.graph_count());
+  long long offset = 0;
+  for (size_t i = 0; i < graphs.size(); i++) {
+    const auto& g = graphs[i];
+    ASSERT_EQ(g.node_count(), batch.node_count(i));
+    ASSERT_EQ(offset, batch.offset(i));
+    offset += g.node_count() * g.node_count();
+    ASSERT_FALSE(batch.negative_cycle(i));
+    ASSERT_EQ(GraphAlgorithms<int>::floyd_warshall(g), batch.table(i));
+  }
+  ASSERT_EQ(offset, batch.distances().size());
+}
+
+TEST(SmallGraphBatchTests, NegativeLabelTest) {
+  SmallGraphBatch batch;
+  AdjacencyList<int> g(5, true);
+  g.add_edge(0, 4, 1);
+  g.add_edge(1, -3, 2);
+  g.add_edge(2, 2, 3);
+  g.add_edge(0, 5, 3);
+  ASSERT_EQ(0, batch.add(g));
+  // packed edges: a repeated edge keeps its smallest label
+  ASSERT_EQ(1, batch.add(3, false, {{0, 4, 1}, {0, 2, 1}, {1, 5, 2}}));
+  ASSERT_EQ(2, batch.add(3, true, {{0, 1, 1}, {1, 1, 2}, {2, -3, 0}}));
+  batch.solve();
+  ASSERT_EQ(GraphAlgorithms<int>::floyd_warshall(g), batch.table(0));
+  ASSERT_EQ((vector<vector<int>>{{0, 2, 7}, {2, 0, 5}, {7, 5, 0}}), batch.table(1));
+  ASSERT_TRUE(batch.negative_cycle(2));
+  ASSERT_EQ(0, batch.table(2).size());
+  // adding more after a solve keeps the earlier tables
+  ASSERT_EQ(3, batch.add(2, true, {{0, 6, 1}}));
+  batch.solve();
+  ASSERT_EQ((vector<vector<int>>{{0, 6}, {std::numeric_limits<int>::max(), 0}}), batch.table(3));
+  ASSERT_EQ(GraphAlgorithms<int>::floyd_warshall(g), batch.table(0));
+}
+
+TEST(SmallGraphBatchTests, RejectTest) {
+  SmallGraphBatch batch;
+  AdjacencyList<int> large(65, true);
+  ASSERT_EQ(-1, batch.add(large));
+  ASSERT_EQ(-1, batch.add(3, true, {{0, 1, 3}}));
+  ASSERT_EQ(-1, batch.add(10, true, {{0, 1 << 27, 1}}));
+  ASSERT_EQ(0, batch.add(10, true, {{0, 1 << 26, 1}}));
+  ASSERT_EQ(1, batch.graph_count());
+  batch.clear();
+  ASSERT_EQ(0, batch.graph_count());
+  ASSERT_EQ(0, batch.add(64, true, {}));
+}
+
 //----------------------------------------------------------------------
 // main
 //----------------------------------------------------------------------
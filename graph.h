@@ -12,6 +12,7 @@
 #define GRAPH_H
 
 #include <vector>
+#include <utility>
 #include <optional>
 
 
@@ -54,6 +55,17 @@ public:
   // edges (i.e., the direct successors of x).  
   virtual std::vector<int> out_nodes(int x) const = 0;
 
+  // Returns the outgoing edges of x as (label, node) pairs, in the
+  // same order as out_nodes(x). The default implementation looks up
+  // each label with get_label.
+  virtual std::vector<std::pair<std::optional<T>,int>> out_edges(int x) const
+  {
+    std::vector<std::pair<std::optional<T>,int>> edges;
+    for (int y : out_nodes(x))
+      edges.push_back(std::make_pair(get_label(x, y), y));
+    return edges;
+  }
+
   // Returns the list of nodes that x is connected to on its incoming
   // edges (i.e., the direct predecessors of x).
   virtual std::vector<int> in_nodes(int x) const = 0;
@@ -11,8 +11,19 @@
 
 #include <vector>
 #include <tuple>
+#include <queue>
+#include <limits>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
 #include "graph.h"
 #include "adjacency_list.h"
+#include "static_graph.h"
+#include "row_queue.h"
+#include "symmetric_matrix.h"
+#include "algorithm_stats.h"
 
 using std::vector;
 using std::pair;
@@ -31,22 +42,130 @@ class GraphAlgorithms
   // using Johnson's algorithm.
   // Input:
   //  g -- the given directed weighted graph
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
   // Output: the minimum path cost between all pairs of vertives given as
   //         a map with the key as a pair of the source and destination,
   //         and the value as the path cost
   //----------------------------------------------------------------------
-  static vector<vector<int>> johnsons(const Graph<int>& g);
+  static vector<vector<int>> johnsons(const Graph<int>& g, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest paths between all pairs of vertices using
+  // Johnson's algorithm with previously prepared potentials (see
+  // johnsons_prepare), skipping the bellman ford phase.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  potentials -- valid potentials for g (see johnsons_potentials_valid)
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the minimum path cost between all pairs of vertices, with
+  //         numeric_limits<int>::max() for unreachable pairs
+  //----------------------------------------------------------------------
+  static vector<vector<int>> johnsons(const Graph<int>& g, const vector<int>& potentials,
+                                      AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest paths between all pairs of vertices using
+  // Johnson's algorithm, handing each source's row to a callback as
+  // soon as it is finished instead of building the table. The row
+  // buffer and the search buffers are reused from source to source,
+  // so the working memory is O(n) however many rows are produced.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  row_done -- called with each source (in order) and its row of
+  //              minimum path costs (numeric_limits<int>::max() for
+  //              unreachable vertices); the row is only valid during
+  //              the call
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: false (with no rows produced) if the graph has a negative
+  //         cycle, true otherwise
+  //----------------------------------------------------------------------
+  static bool johnsons_stream(const Graph<int>& g, const std::function<void(int, const vector<int>&)>& row_done,
+                              AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Same as above, but pushes each finished row into a bounded queue
+  // (blocking while it is full) for a consumer on another thread. The
+  // queue is closed at the end, and the stream stops early if the
+  // consumer closes it.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  queue -- the queue to push (source, row) pairs into
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: false if the graph has a negative cycle or the queue was
+  //         closed before every row was pushed, true otherwise
+  //----------------------------------------------------------------------
+  static bool johnsons_stream(const Graph<int>& g, RowQueue& queue, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Prepare phase of Johnson's algorithm. Computes the vertex
+  // potentials h (the bellman ford distances from a new source with a
+  // 0-weight edge to every node) so that each reduced edge cost
+  // w(u,v) + h[u] - h[v] is non-negative. The new source is not added
+  // to the graph: starting every distance at 0 is equivalent.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the potential of each node, or an empty vector if the
+  //         graph has a negative cycle
+  //----------------------------------------------------------------------
+  static vector<int> johnsons_prepare(const Graph<int>& g, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Query phase of Johnson's algorithm. Single-source shortest paths
+  // from s using a heap-based dijkstra over the reduced edge costs,
+  // which are computed on the fly from g's labels (no reweighted copy
+  // of the graph is made). The potentials stay usable after label
+  // changes as long as every reduced cost remains non-negative.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  potentials -- valid potentials for g
+  //  s -- the source vertex
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the minimum path cost from s to each vertex, with
+  //         numeric_limits<int>::max() for unreachable vertices
+  //----------------------------------------------------------------------
+  static vector<int> johnsons_query(const Graph<int>& g, const vector<int>& potentials, int s,
+                                    AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Checks potentials against every edge of the graph.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  potentials -- the potentials to check
+  // Output: true if every reduced edge cost in g is non-negative
+  //----------------------------------------------------------------------
+  static bool johnsons_potentials_valid(const Graph<int>& g, const vector<int>& potentials);
+
+  //----------------------------------------------------------------------
+  // Checks whether potentials stay valid if edge (x,y) is given the
+  // label. Use before applying a label decrease (or new edge) to keep
+  // using cached potentials; if false, the potentials must be
+  // prepared again.
+  // Input:
+  //  potentials -- valid potentials for the graph
+  //  x, label, y -- the new or changed edge
+  // Output: true if the reduced cost of the edge is non-negative
+  //----------------------------------------------------------------------
+  static bool johnsons_potentials_valid(const vector<int>& potentials, int x, int label, int y);
 
   //----------------------------------------------------------------------
   // Computes the shortest paths between all pairs of vertices
   // using the Floyd-Warshall algorithm.
   // Input:
   //  g -- the given directed weighted graph
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
   // Output: the minimum path cost between all pairs of vertives given as
   //         a map with the key as a pair of the source and destination,
   //         and the value as the path cost
   //----------------------------------------------------------------------
-  static vector<vector<int>> floyd_warshall(const Graph<int>& g);
+  static vector<vector<int>> floyd_warshall(const Graph<int>& g, AlgorithmStats* stats = nullptr);
 
   //----------------------------------------------------------------------
   // Single-source shortest paths from the given source using
@@ -56,12 +175,14 @@ class GraphAlgorithms
   // Input:
   //  g -- the given directed weighted graph
   //  s -- the source vertex
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
   // Output: the minimum path cost from src to each vertex v given as
   //         a vector with indexes as nodes and values as path costs
   //         from s. If the graph has a negative cycle, an empty
   //         vector is returned.
   //----------------------------------------------------------------------
-  static vector<int> bellman_ford_shortest_path(const Graph<int>& g, int s);
+  static vector<int> bellman_ford_shortest_path(const Graph<int>& g, int s, AlgorithmStats* stats = nullptr);
 
   //----------------------------------------------------------------------
   // Single-source shortest paths from the given source using
@@ -70,59 +191,390 @@ class GraphAlgorithms
   // Input:
   //  g -- the given directed weighted graph
   //  s -- the source vertex
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
   // Output: the minimum path cost from src to each vertex v given as
   //         a vector with indexes as nodes and values as path costs
   //         from s
   //----------------------------------------------------------------------
-  static vector<int> dijkstra_shortest_path(const Graph<int>& g, int s);
+  static vector<int> dijkstra_shortest_path(const Graph<int>& g, int s, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Single-pair shortest path cost using Dijkstra's algorithm on a
+  // static snapshot of the graph (which gives the reverse edges needed
+  // by the backward search). The unidirectional search stops once t is
+  // settled; the bidirectional search alternates between a forward
+  // search from s and a backward search from t, stopping once the
+  // smallest keys of the two queues add up to at least the best s-t
+  // path seen. Assumes non-negative edge weights.
+  // Input:
+  //  g -- the snapshot of the given weighted graph
+  //  s -- the source vertex
+  //  t -- the target vertex
+  //  bidirectional -- whether to search from both ends
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the minimum path cost from s to t, or
+  //         numeric_limits<int>::max() if t is unreachable
+  //----------------------------------------------------------------------
+  static int dijkstra_single_pair(const StaticGraph& g, int s, int t, bool bidirectional = true,
+                                  AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest path costs from each of the sources to each
+  // of the targets. Reweights like Johnson's algorithm (a single
+  // Bellman-Ford pass when there are no negative edges), then runs one
+  // Dijkstra per source that stops as soon as every target is
+  // settled, so only the |sources| x |targets| table is computed.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  sources -- the source vertices (rows)
+  //  targets -- the target vertices (columns)
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the table with entry [i][j] the minimum path cost from
+  //         sources[i] to targets[j], numeric_limits<int>::max() if
+  //         unreachable (or either vertex is invalid). If the graph
+  //         has a negative cycle, an empty table is returned.
+  //----------------------------------------------------------------------
+  static vector<vector<int>> many_to_many(const Graph<int>& g, const vector<int>& sources,
+                                          const vector<int>& targets, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Finds the strongly connected components of the graph using an
+  // iterative version of Tarjan's algorithm.
+  // Input:
+  //  g -- the given directed graph
+  // Output: the component of each vertex, numbered in topological
+  //         order of the condensation (every edge between two
+  //         components goes from a lower to a higher number)
+  //----------------------------------------------------------------------
+  static vector<int> strongly_connected_components(const Graph<int>& g);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest paths between all pairs of vertices using
+  // the strongly connected components of the graph. If the graph is
+  // acyclic, each source is solved by relaxing edges in topological
+  // order (O(V*E) overall, with no heap or Bellman-Ford, and negative
+  // weights allowed). Otherwise the Johnson's potentials are found
+  // component by component (Bellman-Ford is only run inside each
+  // component) before the usual per-source Dijkstra. Vertices in
+  // components that come before the source's component are never
+  // searched.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the same table as johnsons (empty if the graph has a
+  //         negative cycle)
+  //----------------------------------------------------------------------
+  static vector<vector<int>> condensed_apsp(const Graph<int>& g, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Groups vertices into clusters by size-constrained label
+  // propagation: every vertex repeatedly takes the label most common
+  // among its (in and out) neighbors, unless that cluster is full, so
+  // densely connected regions end up sharing a label.
+  // Input:
+  //  g -- the given graph
+  //  max_size -- the largest allowed cluster (0 = 2 * sqrt(n))
+  //  rounds -- the maximum number of passes over the vertices
+  // Output: the cluster of each vertex, numbered from 0
+  //----------------------------------------------------------------------
+  static vector<int> label_propagation_clusters(const Graph<int>& g, int max_size = 0, int rounds = 20);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest paths between all pairs of vertices by
+  // partitioning. Each cluster is solved on its own (in parallel),
+  // then the boundary vertices (endpoints of edges between clusters)
+  // are solved on a small graph of cluster-internal boundary distances
+  // and crossing edges, and each pair is combined through the boundary
+  // vertices of the target's cluster. Much cheaper than a global
+  // solve when the clusters are joined by few edges. Negative weights
+  // are handled by reweighting as in Johnson's algorithm.
+  // Input:
+  //  g -- the given directed weighted graph
+  //  clusters -- the cluster of each vertex (any ids), or empty to use
+  //              the cheapest of a few label_propagation_clusters
+  //              size limits
+  //  threads -- number of worker threads (0 = one per core)
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the same table as johnsons (empty if the graph has a
+  //         negative cycle, or if clusters is neither empty nor one
+  //         entry per vertex)
+  //----------------------------------------------------------------------
+  static vector<vector<int>> partitioned_apsp(const Graph<int>& g, const vector<int>& clusters = vector<int>(),
+                                              int threads = 0, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest paths between all pairs of vertices of an
+  // undirected graph using the Floyd-Warshall algorithm on the packed
+  // upper triangle. Since d(i,k) = d(k,i), each pivot phase only
+  // updates the pairs i <= j, about half the work (and memory) of
+  // floyd_warshall.
+  // Input:
+  //  g -- the given undirected weighted graph
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the minimum path costs, with numeric_limits<int>::max()
+  //         for unreachable pairs (an empty matrix if g is directed or
+  //         has a negative edge, which is a negative cycle when
+  //         undirected)
+  //----------------------------------------------------------------------
+  static SymmetricMatrix symmetric_floyd_warshall(const Graph<int>& g, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest paths between all pairs of vertices of an
+  // undirected graph with one Dijkstra per source on the packed upper
+  // triangle. The pair (s,t) with s < t is only needed from s, so the
+  // search from s stops as soon as every vertex after s is settled
+  // (the later sources search less and less of the graph). No
+  // reweighting is needed since the edges can't be negative.
+  // Input:
+  //  g -- the given undirected weighted graph
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the same matrix as symmetric_floyd_warshall
+  //----------------------------------------------------------------------
+  static SymmetricMatrix symmetric_apsp(const Graph<int>& g, AlgorithmStats* stats = nullptr);
+
+  //----------------------------------------------------------------------
+  // Returns the label shared by every edge of the graph, which makes
+  // the shortest path costs hop counts times that label (see
+  // bit_parallel_apsp).
+  // Input:
+  //  g -- the given weighted graph
+  // Output: the shared label (1 if there are no edges), or -1 if the
+  //         labels differ or the shared label is negative
+  //----------------------------------------------------------------------
+  static int uniform_edge_label(const Graph<int>& g);
+
+  //----------------------------------------------------------------------
+  // Computes the shortest paths between all pairs of vertices of a
+  // graph whose edges all have the same non-negative label by breadth
+  // first search from 256 sources at once. Each vertex holds a bitset
+  // with one bit per source of the batch for the current frontier and
+  // for the visited set, so a level is expanded by OR-ing whole
+  // bitsets along the edges and masking out visited bits (word loops
+  // the compiler vectorizes). Batches run in parallel.
+  // Input:
+  //  g -- the given graph (see uniform_edge_label)
+  //  threads -- number of worker threads (0 = one per core)
+  //  stats -- optional counters to add this run's operation counts to
+  //           (only updated when compiled with APSP_STATS)
+  // Output: the same table as johnsons, or an empty table if the
+  //         labels aren't uniform
+  //----------------------------------------------------------------------
+  static vector<vector<int>> bit_parallel_apsp(const Graph<int>& g, int threads = 0,
+                                               AlgorithmStats* stats = nullptr);
+
+ private:
+
+  // the johnsons_query search from s into dists, using (and leaving
+  // behind) the given search buffers, which must have n entries
+  static void johnsons_row(const Graph<int>& g, const vector<int>& potentials, int s, vector<int>& dists,
+                           vector<long long>& reduced, vector<bool>& settled, AlgorithmStats* stats);
+
+  // runs f(i) for i in [0, count) on the given number of threads, with
+  // each thread's counts added to stats at the end
+  template<typename F>
+  static void parallel_for(int count, int threads, AlgorithmStats* stats, F f);
+
 };
 
 
 template <typename T>
-vector<vector<int>> GraphAlgorithms<T>::johnsons(const Graph<int>& g) {
+vector<vector<int>> GraphAlgorithms<T>::johnsons(const Graph<int>& g, AlgorithmStats* stats) {
+  // reweighting using bellman ford
+  vector<int> potentials = johnsons_prepare(g, stats);
+  if (potentials.size() != g.node_count()) {
+    return vector<vector<int>>();  // negative cycle
+  }
+
+  return johnsons(g, potentials, stats);
+}
+
+template <typename T>
+vector<vector<int>> GraphAlgorithms<T>::johnsons(const Graph<int>& g, const vector<int>& potentials,
+                                                 AlgorithmStats* stats) {
   vector<vector<int>> dists;
 
-  // reweighting using bellman ford
-  // create new graph h
-  int s = g.node_count();
-  AdjacencyList<int> h(s + 1, true);
-  // for each edge in g
+  // run dijkstras on each node using the reweighted edges
   for (int u = 0; u < g.node_count(); u++) {
-    for (int v : g.out_nodes(u)) {
-      h.add_edge(u, g.get_label(u, v).value(), v);
-    }
-    h.add_edge(s, 0, u);
+    dists.push_back(johnsons_query(g, potentials, u, stats));
+    APSP_STAT(stats, bytes_allocated, dists[u].capacity() * sizeof(int));
   }
 
-  auto bellman_ford_dists = bellman_ford_shortest_path(h, s);
+  return dists;
+}
 
-  AdjacencyList<int> reweighted_g(g.node_count(), true);
-  // for each edge in g
-  for (int u = 0; u < g.node_count(); u++) {
-    for (int v : g.out_nodes(u)) {
-      int new_weight = g.get_label(u, v).value() + bellman_ford_dists[u] - bellman_ford_dists[v];  // w(u, v) + h[u] – h[v]
-      reweighted_g.add_edge(u, new_weight, v);
+template <typename T>
+vector<int> GraphAlgorithms<T>::johnsons_prepare(const Graph<int>& g, AlgorithmStats* stats) {
+  int n = g.node_count();
+
+  // distances from the new source start at 0 (its 0-weight edge)
+  vector<int> h(n, 0);
+  APSP_STAT(stats, bytes_allocated, h.capacity() * sizeof(int));
+
+  // shortest paths from the new source use at most n-1 edges of g, so
+  // a change in round n means a negative cycle
+  for (int round = 1; round <= n; round++) {
+    APSP_STAT(stats, bellman_ford_rounds, 1);
+    bool changed = false;
+    for (int u = 0; u < n; u++) {
+      auto edges = g.out_edges(u);
+      APSP_STAT(stats, relaxations, edges.size());
+      for (const auto& [label, v] : edges) {
+        if (h[u] + label.value() < h[v]) {
+          h[v] = h[u] + label.value();
+          changed = true;
+          APSP_STAT(stats, successful_relaxations, 1);
+        }
+      }
+    }
+    if (!changed) {
+      return h;
     }
   }
 
-  // run dijkstras on each node in reweighted path
-  for (int u = 0; u < g.node_count(); u++) {
-    dists.push_back(vector<int>());
+  return vector<int>();
+}
 
-    vector<int> dijkstras_dist = dijkstra_shortest_path(reweighted_g, u);
+template <typename T>
+bool GraphAlgorithms<T>::johnsons_stream(const Graph<int>& g,
+                                         const std::function<void(int, const vector<int>&)>& row_done,
+                                         AlgorithmStats* stats) {
+  int n = g.node_count();
+  vector<int> potentials = johnsons_prepare(g, stats);
+  if (potentials.size() != n) {
+    return false;  // negative cycle
+  }
 
-    for (int v = 0; v < g.node_count(); v++) {
-      int real_dist = dijkstras_dist[v] - bellman_ford_dists[u] + bellman_ford_dists[v];  // get real distance without reweighting
-      dists[u].push_back(real_dist);
-    } 
+  // one row and one set of search buffers for every source
+  vector<int> dists(n);
+  vector<long long> reduced(n);
+  vector<bool> settled(n);
+  APSP_STAT(stats, bytes_allocated, dists.capacity() * sizeof(int) + reduced.capacity() * sizeof(long long)
+            + n / 8);
+  for (int u = 0; u < n; u++) {
+    johnsons_row(g, potentials, u, dists, reduced, settled, stats);
+    row_done(u, dists);
+  }
+  return true;
+}
+
+template <typename T>
+bool GraphAlgorithms<T>::johnsons_stream(const Graph<int>& g, RowQueue& queue, AlgorithmStats* stats) {
+  int n = g.node_count();
+  vector<int> potentials = johnsons_prepare(g, stats);
+  if (potentials.size() != n) {
+    queue.close();
+    return false;  // negative cycle
+  }
+
+  // the row buffer is swapped for a recycled one on every push
+  vector<int> dists(n);
+  vector<long long> reduced(n);
+  vector<bool> settled(n);
+  APSP_STAT(stats, bytes_allocated, reduced.capacity() * sizeof(long long) + n / 8);
+  bool complete = true;
+  for (int u = 0; u < n && complete; u++) {
+    if (dists.capacity() < (size_t) n) {
+      APSP_STAT(stats, bytes_allocated, n * sizeof(int));
+    }
+    dists.resize(n);
+    johnsons_row(g, potentials, u, dists, reduced, settled, stats);
+    complete = queue.push(u, dists);
+  }
+  queue.close();
+  return complete;
+}
+
+template <typename T>
+vector<int> GraphAlgorithms<T>::johnsons_query(const Graph<int>& g, const vector<int>& potentials, int s,
+                                               AlgorithmStats* stats) {
+  int n = g.node_count();
+  vector<int> dists(n, std::numeric_limits<int>::max());
+  if (s < 0 || s >= n) {
+    return dists;
   }
 
+  vector<long long> reduced(n);
+  vector<bool> settled(n);
+  APSP_STAT(stats, bytes_allocated, dists.capacity() * sizeof(int) + reduced.capacity() * sizeof(long long)
+            + n / 8);
+  johnsons_row(g, potentials, s, dists, reduced, settled, stats);
   return dists;
 }
 
 template <typename T>
-vector<vector<int>> GraphAlgorithms<T>::floyd_warshall(const Graph<int>& g) {
+void GraphAlgorithms<T>::johnsons_row(const Graph<int>& g, const vector<int>& potentials, int s,
+                                      vector<int>& dists, vector<long long>& reduced, vector<bool>& settled,
+                                      AlgorithmStats* stats) {
+  const long long inf = std::numeric_limits<long long>::max();
+  int n = g.node_count();
+
+  // reduced distances (can exceed an int before being mapped back)
+  std::fill(reduced.begin(), reduced.end(), inf);
+  std::fill(settled.begin(), settled.end(), false);
+  std::priority_queue<pair<long long,int>, vector<pair<long long,int>>, std::greater<pair<long long,int>>> heap;
+
+  reduced[s] = 0;
+  heap.push(std::make_pair(0LL, s));
+  APSP_STAT(stats, heap_pushes, 1);
+
+  while (!heap.empty()) {
+    auto [d, u] = heap.top();
+    heap.pop();
+    APSP_STAT(stats, heap_pops, 1);
+    if (settled[u]) {
+      continue;  // stale entry
+    }
+    settled[u] = true;
+
+    for (const auto& [label, v] : g.out_edges(u)) {
+      APSP_STAT(stats, relaxations, 1);
+      long long reduced_cost = (long long) label.value() + potentials[u] - potentials[v];  // w(u, v) + h[u] - h[v]
+      if (d + reduced_cost < reduced[v]) {
+        reduced[v] = d + reduced_cost;
+        heap.push(std::make_pair(reduced[v], v));
+        APSP_STAT(stats, successful_relaxations, 1);
+        APSP_STAT(stats, heap_pushes, 1);
+      }
+    }
+  }
+
+  // get real distance without reweighting
+  for (int v = 0; v < n; v++) {
+    dists[v] = reduced[v] == inf ? std::numeric_limits<int>::max() : reduced[v] - potentials[s] + potentials[v];
+  }
+}
+
+template <typename T>
+bool GraphAlgorithms<T>::johnsons_potentials_valid(const Graph<int>& g, const vector<int>& potentials) {
+  if (potentials.size() != g.node_count()) {
+    return false;
+  }
+  for (int u = 0; u < g.node_count(); u++) {
+    for (const auto& [label, v] : g.out_edges(u)) {
+      if (!johnsons_potentials_valid(potentials, u, label.value(), v)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename T>
+bool GraphAlgorithms<T>::johnsons_potentials_valid(const vector<int>& potentials, int x, int label, int y) {
+  return (long long) label + potentials[x] - potentials[y] >= 0;
+}
+
+template <typename T>
+vector<vector<int>> GraphAlgorithms<T>::floyd_warshall(const Graph<int>& g, AlgorithmStats* stats) {
   int A[g.node_count() + 1][g.node_count()][g.node_count()];
+  APSP_STAT(stats, bytes_allocated, sizeof(A));
 
   for (int u = 0; u < g.node_count(); u++) {
     for (int v = 0; v < g.node_count(); v++) {
@@ -137,6 +589,8 @@ vector<vector<int>> GraphAlgorithms<T>::floyd_warshall(const Graph<int>& g) {
   }
 
   for (int k = 0; k < g.node_count(); k++) {
+    APSP_STAT(stats, pivot_phases, 1);
+    APSP_STAT(stats, relaxations, (long long) g.node_count() * g.node_count());
     for (int u = 0; u < g.node_count(); u++) {
       for (int v = 0; v < g.node_count(); v++) {
         int cur_length = A[k][u][v];
@@ -147,6 +601,7 @@ vector<vector<int>> GraphAlgorithms<T>::floyd_warshall(const Graph<int>& g) {
           A[k+1][u][v] = cur_length;
         } else {
           A[k+1][u][v] = first_segment + second_segment;
+          APSP_STAT(stats, successful_relaxations, 1);
         }
       }
     }
@@ -164,6 +619,7 @@ vector<vector<int>> GraphAlgorithms<T>::floyd_warshall(const Graph<int>& g) {
     for (int v = 0; v < g.node_count(); v++) {
       dists[u].push_back(A[g.node_count()][u][v]);
     }
+    APSP_STAT(stats, bytes_allocated, dists[u].capacity() * sizeof(int));
   }
 
   return dists;
@@ -171,21 +627,25 @@ vector<vector<int>> GraphAlgorithms<T>::floyd_warshall(const Graph<int>& g) {
 
 
 template<typename T>
-vector<int> GraphAlgorithms<T>::bellman_ford_shortest_path(const Graph<int>& g, int s) {
+vector<int> GraphAlgorithms<T>::bellman_ford_shortest_path(const Graph<int>& g, int s, AlgorithmStats* stats) {
   vector<int> dists;
   for (int v = 0; v < g.node_count(); v++) {
     dists.push_back(std::numeric_limits<int>::max());
   }
+  APSP_STAT(stats, bytes_allocated, dists.capacity() * sizeof(int));
 
   dists[s] = 0;
 
   for (int i = 0; i < g.node_count(); i++) {
+    APSP_STAT(stats, bellman_ford_rounds, 1);
     // for each edge
     for (int u = 0; u < g.node_count(); u++) {
       vector<int> out_nodes = g.out_nodes(u);
+      APSP_STAT(stats, relaxations, out_nodes.size());
       for (int v : out_nodes) {
         if (dists[v] > dists[u] + g.get_label(u, v).value() && dists[u] != std::numeric_limits<int>::max()) {
           dists[v] = dists[u] + g.get_label(u, v).value();
+          APSP_STAT(stats, successful_relaxations, 1);
         }
       }
     }
@@ -206,7 +666,7 @@ vector<int> GraphAlgorithms<T>::bellman_ford_shortest_path(const Graph<int>& g,
 
 
 template <typename T>
-vector<int> GraphAlgorithms<T>::dijkstra_shortest_path(const Graph<int>& g, int s) {
+vector<int> GraphAlgorithms<T>::dijkstra_shortest_path(const Graph<int>& g, int s, AlgorithmStats* stats) {
   vector<int> dist;
 
   if (g.node_count() == 0) {
@@ -229,6 +689,10 @@ vector<int> GraphAlgorithms<T>::dijkstra_shortest_path(const Graph<int>& g, int
       edges.push_back(std::pair<int,int>(i,j));
     }
   }
+  // the candidate edge list acts as the priority queue
+  APSP_STAT(stats, heap_pushes, edges.size());
+  APSP_STAT(stats, bytes_allocated, dist.capacity() * sizeof(int) + g.node_count() * sizeof(bool)
+            + edges.capacity() * sizeof(pair<int,int>));
 
   while (true) {
     int minDist = -1;
@@ -237,6 +701,7 @@ vector<int> GraphAlgorithms<T>::dijkstra_shortest_path(const Graph<int>& g, int
     for (int i = 0; i < edges.size(); i++) {
       pair<int,int> edge = edges[i];
       if (excluded[edge.first] && !excluded[edge.second]) {
+        APSP_STAT(stats, relaxations, 1);
         int edgeDist = dist[edge.first] + g.get_label(edge.first, edge.second).value();
         if (edgeDist < minDist || minDist == -1) {
           minDist = edgeDist;
@@ -249,6 +714,8 @@ vector<int> GraphAlgorithms<T>::dijkstra_shortest_path(const Graph<int>& g, int
       break;
     }
     excluded[minEdge.second] = true;
+    APSP_STAT(stats, heap_pops, 1);
+    APSP_STAT(stats, successful_relaxations, 1);
     
     dist[minEdge.second] = minDist;
 
@@ -258,5 +725,887 @@ vector<int> GraphAlgorithms<T>::dijkstra_shortest_path(const Graph<int>& g, int
   return dist;
 }
 
+template <typename T>
+int GraphAlgorithms<T>::dijkstra_single_pair(const StaticGraph& g, int s, int t, bool bidirectional,
+                                             AlgorithmStats* stats) {
+  const long long inf = std::numeric_limits<long long>::max();
+  int n = g.node_count();
+  if (s < 0 || s >= n || t < 0 || t >= n) {
+    return std::numeric_limits<int>::max();
+  }
+  if (s == t) {
+    return 0;
+  }
+
+  // index 0 is the forward search from s, index 1 the backward search
+  // from t (over incoming edges)
+  typedef std::priority_queue<pair<long long,int>, vector<pair<long long,int>>,
+                              std::greater<pair<long long,int>>> MinHeap;
+  vector<long long> dist[2] = {vector<long long>(n, inf), vector<long long>(bidirectional ? n : 0, inf)};
+  MinHeap heap[2];
+  APSP_STAT(stats, bytes_allocated, (dist[0].capacity() + dist[1].capacity()) * sizeof(long long));
+
+  dist[0][s] = 0;
+  heap[0].push(std::make_pair(0LL, s));
+  APSP_STAT(stats, heap_pushes, 1);
+  if (bidirectional) {
+    dist[1][t] = 0;
+    heap[1].push(std::make_pair(0LL, t));
+    APSP_STAT(stats, heap_pushes, 1);
+  }
+  long long best = inf;
+
+  while (!heap[0].empty() || (bidirectional && !heap[1].empty())) {
+    long long forward_min = heap[0].empty() ? inf : heap[0].top().first;
+    long long backward_min = !bidirectional || heap[1].empty() ? inf : heap[1].top().first;
+
+    // no path left to find is shorter than the best one
+    if (bidirectional && (forward_min == inf || backward_min == inf || forward_min + backward_min >= best)) {
+      break;
+    }
+
+    // expand the side with the smaller queue
+    int side = !bidirectional || heap[0].size() <= heap[1].size() ? 0 : 1;
+    auto [d, u] = heap[side].top();
+    heap[side].pop();
+    APSP_STAT(stats, heap_pops, 1);
+    if (d > dist[side][u]) {
+      continue;  // stale entry
+    }
+    if (!bidirectional && u == t) {
+      best = d;  // settled the target
+      break;
+    }
+
+    auto arcs = side == 0 ? g.out_arcs(u) : g.in_arcs(u);
+    for (const auto& arc : arcs) {
+      APSP_STAT(stats, relaxations, 1);
+      long long next = d + arc.label;
+      if (next < dist[side][arc.node]) {
+        dist[side][arc.node] = next;
+        heap[side].push(std::make_pair(next, arc.node));
+        APSP_STAT(stats, successful_relaxations, 1);
+        APSP_STAT(stats, heap_pushes, 1);
+        // a path through arc.node meeting the other search
+        if (bidirectional && dist[1 - side][arc.node] != inf) {
+          best = std::min(best, next + dist[1 - side][arc.node]);
+        }
+      }
+    }
+  }
+
+  return best == inf ? std::numeric_limits<int>::max() : best;
+}
+
+template <typename T>
+vector<vector<int>> GraphAlgorithms<T>::many_to_many(const Graph<int>& g, const vector<int>& sources,
+                                                     const vector<int>& targets, AlgorithmStats* stats) {
+  const long long inf = std::numeric_limits<long long>::max();
+  int n = g.node_count();
+  vector<int> potentials = johnsons_prepare(g, stats);
+  if (potentials.size() != n) {
+    return vector<vector<int>>();  // negative cycle
+  }
+  StaticGraph sg(g);
+
+  // distinct valid targets
+  vector<bool> is_target(n, false);
+  int target_count = 0;
+  for (int t : targets) {
+    if (t >= 0 && t < n && !is_target[t]) {
+      is_target[t] = true;
+      target_count++;
+    }
+  }
+
+  vector<vector<int>> table(sources.size(), vector<int>(targets.size(), std::numeric_limits<int>::max()));
+  vector<long long> reduced(n, inf);
+  vector<bool> settled(n, false);
+  vector<int> touched;
+  std::priority_queue<pair<long long,int>, vector<pair<long long,int>>, std::greater<pair<long long,int>>> heap;
+  APSP_STAT(stats, bytes_allocated, reduced.capacity() * sizeof(long long) + n / 4
+            + sources.size() * targets.size() * sizeof(int));
+
+  for (size_t i = 0; i < sources.size(); i++) {
+    int s = sources[i];
+    if (s < 0 || s >= n) {
+      continue;
+    }
+
+    // dijkstra over reduced costs until every target is settled
+    int remaining = target_count;
+    reduced[s] = 0;
+    touched.push_back(s);
+    heap.push(std::make_pair(0LL, s));
+    APSP_STAT(stats, heap_pushes, 1);
+    while (!heap.empty() && remaining > 0) {
+      auto [d, u] = heap.top();
+      heap.pop();
+      APSP_STAT(stats, heap_pops, 1);
+      if (settled[u]) {
+        continue;  // stale entry
+      }
+      settled[u] = true;
+      if (is_target[u]) {
+        remaining--;
+      }
+
+      for (const auto& arc : sg.out_arcs(u)) {
+        APSP_STAT(stats, relaxations, 1);
+        long long reduced_cost = (long long) arc.label + potentials[u] - potentials[arc.node];
+        if (d + reduced_cost < reduced[arc.node]) {
+          if (reduced[arc.node] == inf) {
+            touched.push_back(arc.node);
+          }
+          reduced[arc.node] = d + reduced_cost;
+          heap.push(std::make_pair(reduced[arc.node], arc.node));
+          APSP_STAT(stats, successful_relaxations, 1);
+          APSP_STAT(stats, heap_pushes, 1);
+        }
+      }
+    }
+
+    // real distances to the (settled) targets
+    for (size_t j = 0; j < targets.size(); j++) {
+      int t = targets[j];
+      if (t >= 0 && t < n && settled[t]) {
+        table[i][j] = reduced[t] - potentials[s] + potentials[t];
+      }
+    }
+
+    for (int u : touched) {
+      reduced[u] = inf;
+      settled[u] = false;
+    }
+    touched.clear();
+    heap = decltype(heap)();
+  }
+
+  return table;
+}
+
+template <typename T>
+vector<int> GraphAlgorithms<T>::strongly_connected_components(const Graph<int>& g) {
+  int n = g.node_count();
+  StaticGraph sg(g);
+
+  vector<int> index(n, -1);  // discovery order
+  vector<int> low(n, 0);
+  vector<bool> on_stack(n, false);
+  vector<int> stack;
+  vector<int> component(n, -1);
+  int next_index = 0;
+  int components = 0;
+
+  // explicit call stack of (vertex, next arc to look at)
+  vector<pair<int,int>> calls;
+  for (int root = 0; root < n; root++) {
+    if (index[root] >= 0) {
+      continue;
+    }
+    calls.push_back(std::make_pair(root, 0));
+    index[root] = low[root] = next_index++;
+    stack.push_back(root);
+    on_stack[root] = true;
+
+    while (!calls.empty()) {
+      auto& [u, next_arc] = calls.back();
+      auto arcs = sg.out_arcs(u);
+      if (next_arc < arcs.size()) {
+        int v = arcs.begin()[next_arc++].node;
+        if (index[v] < 0) {
+          // "recursive call" on v
+          index[v] = low[v] = next_index++;
+          stack.push_back(v);
+          on_stack[v] = true;
+          calls.push_back(std::make_pair(v, 0));
+        } else if (on_stack[v]) {
+          low[u] = std::min(low[u], index[v]);
+        }
+        continue;
+      }
+
+      // u is finished: pop its component if it is the root of one
+      int finished = u;
+      calls.pop_back();
+      if (low[finished] == index[finished]) {
+        int v;
+        do {
+          v = stack.back();
+          stack.pop_back();
+          on_stack[v] = false;
+          component[v] = components;
+        } while (v != finished);
+        components++;
+      }
+      if (!calls.empty()) {
+        int parent = calls.back().first;
+        low[parent] = std::min(low[parent], low[finished]);
+      }
+    }
+  }
+
+  // tarjan finishes components in reverse topological order
+  for (int v = 0; v < n; v++) {
+    component[v] = components - 1 - component[v];
+  }
+  return component;
+}
+
+template <typename T>
+vector<vector<int>> GraphAlgorithms<T>::condensed_apsp(const Graph<int>& g, AlgorithmStats* stats) {
+  const int inf = std::numeric_limits<int>::max();
+  int n = g.node_count();
+  StaticGraph sg(g);
+  vector<int> component = strongly_connected_components(g);
+
+  // vertices grouped by component, in topological order
+  int components = 0;
+  for (int c : component) {
+    components = std::max(components, c + 1);
+  }
+  vector<int> start(components + 1, 0);
+  for (int c : component) {
+    start[c + 1]++;
+  }
+  for (int c = 0; c < components; c++) {
+    start[c + 1] += start[c];
+  }
+  vector<int> order(n);
+  vector<int> fill(start.begin(), start.end() - 1);
+  for (int v = 0; v < n; v++) {
+    order[fill[component[v]]++] = v;
+  }
+
+  // a self loop makes its vertex's component cyclic
+  bool acyclic = components == n;
+  for (int u = 0; u < n && acyclic; u++) {
+    for (const auto& arc : sg.out_arcs(u)) {
+      if (arc.node == u) {
+        acyclic = false;
+        break;
+      }
+    }
+  }
+
+  if (acyclic) {
+    // relax in topological order from each source; vertices ordered
+    // before the source are unreachable
+    vector<vector<int>> dists(n, vector<int>(n, inf));
+    APSP_STAT(stats, bytes_allocated, (long long) n * n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+      int s = order[i];
+      vector<int>& dist = dists[s];
+      dist[s] = 0;
+      for (int j = i; j < n; j++) {
+        int u = order[j];
+        if (dist[u] == inf) {
+          continue;
+        }
+        for (const auto& arc : sg.out_arcs(u)) {
+          APSP_STAT(stats, relaxations, 1);
+          if ((long long) dist[u] + arc.label < dist[arc.node]) {
+            dist[arc.node] = dist[u] + arc.label;
+            APSP_STAT(stats, successful_relaxations, 1);
+          }
+        }
+      }
+    }
+    return dists;
+  }
+
+  // potentials component by component: edges from earlier components
+  // are final when a component is reached, so Bellman-Ford only has to
+  // settle the edges inside it
+  vector<int> h(n, 0);
+  APSP_STAT(stats, bytes_allocated, h.capacity() * sizeof(int));
+  for (int c = 0; c < components; c++) {
+    int size = start[c + 1] - start[c];
+    bool changed = true;
+    for (int round = 1; changed; round++) {
+      if (round > size) {
+        return vector<vector<int>>();  // negative cycle
+      }
+      APSP_STAT(stats, bellman_ford_rounds, 1);
+      changed = false;
+      for (int i = start[c]; i < start[c + 1]; i++) {
+        int u = order[i];
+        for (const auto& arc : sg.out_arcs(u)) {
+          if (component[arc.node] != c) {
+            continue;
+          }
+          APSP_STAT(stats, relaxations, 1);
+          if (h[u] + arc.label < h[arc.node]) {
+            h[arc.node] = h[u] + arc.label;
+            changed = true;
+            APSP_STAT(stats, successful_relaxations, 1);
+          }
+        }
+      }
+    }
+
+    // push the final values into later components
+    for (int i = start[c]; i < start[c + 1]; i++) {
+      int u = order[i];
+      for (const auto& arc : sg.out_arcs(u)) {
+        if (component[arc.node] == c) {
+          continue;
+        }
+        APSP_STAT(stats, relaxations, 1);
+        if (h[u] + arc.label < h[arc.node]) {
+          h[arc.node] = h[u] + arc.label;
+          APSP_STAT(stats, successful_relaxations, 1);
+        }
+      }
+    }
+  }
+
+  return johnsons(g, h, stats);
+}
+
+template <typename T>
+template <typename F>
+void GraphAlgorithms<T>::parallel_for(int count, int threads, AlgorithmStats* stats, F f) {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::max(1, std::min(threads, count));
+  vector<AlgorithmStats> thread_stats(threads);
+  std::atomic<int> next(0);
+  auto work = [&](int t) {
+    for (int i = next++; i < count; i = next++) {
+      f(i, &thread_stats[t]);
+    }
+  };
+  if (threads == 1) {
+    work(0);
+  } else {
+    vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back(work, t);
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+  if (stats) {
+    for (const auto& counts : thread_stats) {
+      *stats += counts;
+    }
+  }
+}
+
+template <typename T>
+vector<int> GraphAlgorithms<T>::label_propagation_clusters(const Graph<int>& g, int max_size, int rounds) {
+  int n = g.node_count();
+  StaticGraph sg(g);
+  if (max_size <= 0) {
+    max_size = 2;
+    while (max_size * max_size < 4 * n) {
+      max_size++;
+    }
+  }
+  vector<int> label(n);
+  vector<int> size(n, 1);
+  for (int v = 0; v < n; v++) {
+    label[v] = v;
+  }
+
+  // per-label neighbor counts (reset through the seen list)
+  vector<int> count(n, 0);
+  vector<int> seen;
+  for (int round = 0; round < rounds; round++) {
+    bool changed = false;
+    for (int v = 0; v < n; v++) {
+      for (auto arcs : {sg.out_arcs(v), sg.in_arcs(v)}) {
+        for (const auto& arc : arcs) {
+          if (arc.node != v && count[label[arc.node]]++ == 0) {
+            seen.push_back(label[arc.node]);
+          }
+        }
+      }
+      // most common label with room left, ties to the smaller label
+      int best = label[v];
+      int best_count = 0;
+      for (int l : seen) {
+        bool fits = l == label[v] || size[l] < max_size;
+        if (fits && (count[l] > best_count || (count[l] == best_count && l < best))) {
+          best = l;
+          best_count = count[l];
+        }
+        count[l] = 0;
+      }
+      seen.clear();
+      if (best_count > 0 && best != label[v]) {
+        size[label[v]]--;
+        size[best]++;
+        label[v] = best;
+        changed = true;
+      }
+    }
+    if (!changed) {
+      break;
+    }
+  }
+
+  // number the clusters from 0
+  vector<int> number(n, -1);
+  int clusters = 0;
+  for (int v = 0; v < n; v++) {
+    if (number[label[v]] < 0) {
+      number[label[v]] = clusters++;
+    }
+    label[v] = number[label[v]];
+  }
+  return label;
+}
+
+template <typename T>
+vector<vector<int>> GraphAlgorithms<T>::partitioned_apsp(const Graph<int>& g, const vector<int>& clusters,
+                                                         int threads, AlgorithmStats* stats) {
+  const long long inf = std::numeric_limits<long long>::max();
+  typedef std::priority_queue<pair<long long,int>, vector<pair<long long,int>>,
+                              std::greater<pair<long long,int>>> MinHeap;
+  int n = g.node_count();
+  if (!clusters.empty() && (int) clusters.size() != n) {
+    return vector<vector<int>>();
+  }
+  vector<int> potentials = johnsons_prepare(g, stats);
+  if (potentials.size() != n) {
+    return vector<vector<int>>();  // negative cycle
+  }
+  StaticGraph sg(g);
+  auto reduced_cost = [&](int u, const StaticGraph::Arc& arc) {
+    return (long long) arc.label + potentials[u] - potentials[arc.node];
+  };
+
+  // cluster of each vertex, numbered from 0
+  vector<int> cluster;
+  if (!clusters.empty()) {
+    vector<int> ids(clusters);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    for (int id : clusters) {
+      cluster.push_back(std::lower_bound(ids.begin(), ids.end(), id) - ids.begin());
+    }
+  } else {
+    // try a few cluster size limits and keep the partition with the
+    // cheapest estimated solve
+    long long best_cost = -1;
+    int limit = 2;
+    while (limit * limit < 4 * n) {
+      limit++;
+    }
+    for (int tries = 0; tries < 4 && (tries == 0 || limit / 2 < n); tries++, limit *= 2) {
+      vector<int> candidate = label_propagation_clusters(g, limit);
+      int k = 0;
+      for (int c : candidate) {
+        k = std::max(k, c + 1);
+      }
+      vector<long long> size(k, 0), border(k, 0);
+      long long b = 0;
+      for (int v = 0; v < n; v++) {
+        size[candidate[v]]++;
+        bool crossing = false;
+        for (auto arcs : {sg.out_arcs(v), sg.in_arcs(v)}) {
+          for (const auto& arc : arcs) {
+            crossing = crossing || candidate[arc.node] != candidate[v];
+          }
+        }
+        border[candidate[v]] += crossing;
+        b += crossing;
+      }
+      // cluster solves, boundary solve, and the two combining steps
+      long long cost = b * b;
+      for (int c = 0; c < k; c++) {
+        cost += size[c] * size[c] + size[c] * border[c] * (b + n);
+      }
+      if (best_cost < 0 || cost < best_cost) {
+        best_cost = cost;
+        cluster = candidate;
+      }
+    }
+  }
+  int k = 0;
+  for (int c : cluster) {
+    k = std::max(k, c + 1);
+  }
+
+  // members of each cluster (local index = position), and the boundary
+  // vertices (global index = position in boundary)
+  vector<vector<int>> members(k);
+  vector<int> local(n);
+  for (int v = 0; v < n; v++) {
+    local[v] = members[cluster[v]].size();
+    members[cluster[v]].push_back(v);
+  }
+  vector<int> boundary_index(n, -1);
+  vector<int> boundary;
+  vector<vector<int>> cluster_boundary(k);
+  for (int v = 0; v < n; v++) {
+    bool crossing = false;
+    for (auto arcs : {sg.out_arcs(v), sg.in_arcs(v)}) {
+      for (const auto& arc : arcs) {
+        crossing = crossing || cluster[arc.node] != cluster[v];
+      }
+    }
+    if (crossing) {
+      boundary_index[v] = boundary.size();
+      boundary.push_back(v);
+      cluster_boundary[cluster[v]].push_back(v);
+    }
+  }
+  int b = boundary.size();
+
+  // 1. reduced distances within each cluster (row major, local indexes)
+  vector<vector<long long>> inside(k);
+  parallel_for(k, threads, stats, [&](int c, AlgorithmStats* counts) {
+    int m = members[c].size();
+    inside[c].assign((long long) m * m, inf);
+    APSP_STAT(counts, bytes_allocated, (long long) m * m * sizeof(long long));
+    for (int i = 0; i < m; i++) {
+      long long* dist = inside[c].data() + (long long) i * m;
+      MinHeap heap;
+      dist[i] = 0;
+      heap.push(std::make_pair(0LL, i));
+      APSP_STAT(counts, heap_pushes, 1);
+      while (!heap.empty()) {
+        auto [d, x] = heap.top();
+        heap.pop();
+        APSP_STAT(counts, heap_pops, 1);
+        if (d > dist[x]) {
+          continue;  // stale entry
+        }
+        int u = members[c][x];
+        for (const auto& arc : sg.out_arcs(u)) {
+          if (cluster[arc.node] != c) {
+            continue;
+          }
+          APSP_STAT(counts, relaxations, 1);
+          int y = local[arc.node];
+          if (d + reduced_cost(u, arc) < dist[y]) {
+            dist[y] = d + reduced_cost(u, arc);
+            heap.push(std::make_pair(dist[y], y));
+            APSP_STAT(counts, successful_relaxations, 1);
+            APSP_STAT(counts, heap_pushes, 1);
+          }
+        }
+      }
+    }
+  });
+  auto inside_dist = [&](int u, int v) {
+    int c = cluster[u];
+    return inside[c][(long long) local[u] * members[c].size() + local[v]];
+  };
+
+  // 2. reduced distances between boundary vertices, over crossing edges
+  // and cluster-internal boundary to boundary distances
+  vector<vector<pair<int,long long>>> boundary_edges(b);
+  for (int i = 0; i < b; i++) {
+    int u = boundary[i];
+    for (int v : cluster_boundary[cluster[u]]) {
+      if (v != u && inside_dist(u, v) != inf) {
+        boundary_edges[i].push_back(std::make_pair(boundary_index[v], inside_dist(u, v)));
+      }
+    }
+    for (const auto& arc : sg.out_arcs(u)) {
+      if (cluster[arc.node] != cluster[u]) {
+        boundary_edges[i].push_back(std::make_pair(boundary_index[arc.node], reduced_cost(u, arc)));
+      }
+    }
+  }
+  vector<long long> across((long long) b * b, inf);
+  APSP_STAT(stats, bytes_allocated, (long long) b * b * sizeof(long long));
+  parallel_for(b, threads, stats, [&](int i, AlgorithmStats* counts) {
+    long long* dist = across.data() + (long long) i * b;
+    MinHeap heap;
+    dist[i] = 0;
+    heap.push(std::make_pair(0LL, i));
+    APSP_STAT(counts, heap_pushes, 1);
+    while (!heap.empty()) {
+      auto [d, x] = heap.top();
+      heap.pop();
+      APSP_STAT(counts, heap_pops, 1);
+      if (d > dist[x]) {
+        continue;  // stale entry
+      }
+      for (const auto& [y, weight] : boundary_edges[x]) {
+        APSP_STAT(counts, relaxations, 1);
+        if (d + weight < dist[y]) {
+          dist[y] = d + weight;
+          heap.push(std::make_pair(dist[y], y));
+          APSP_STAT(counts, successful_relaxations, 1);
+          APSP_STAT(counts, heap_pushes, 1);
+        }
+      }
+    }
+  });
+
+  // 3. each row: distances from u to every boundary vertex (leaving u's
+  // cluster through one of its boundary vertices), then to every v
+  // (entering v's cluster through one of its boundary vertices, or
+  // staying inside u's cluster)
+  vector<vector<int>> dists(n, vector<int>(n, std::numeric_limits<int>::max()));
+  APSP_STAT(stats, bytes_allocated, (long long) n * n * sizeof(int));
+  parallel_for(n, threads, stats, [&](int u, AlgorithmStats* counts) {
+    vector<long long> to_boundary(b, inf);
+    for (int a : cluster_boundary[cluster[u]]) {
+      long long first = inside_dist(u, a);
+      if (first == inf) {
+        continue;
+      }
+      const long long* from_a = across.data() + (long long) boundary_index[a] * b;
+      for (int j = 0; j < b; j++) {
+        APSP_STAT(counts, relaxations, 1);
+        if (from_a[j] != inf && first + from_a[j] < to_boundary[j]) {
+          to_boundary[j] = first + from_a[j];
+        }
+      }
+    }
+
+    for (int v = 0; v < n; v++) {
+      long long best = cluster[v] == cluster[u] ? inside_dist(u, v) : inf;
+      for (int a : cluster_boundary[cluster[v]]) {
+        long long last = inside_dist(a, v);
+        long long first = to_boundary[boundary_index[a]];
+        APSP_STAT(counts, relaxations, 1);
+        if (first != inf && last != inf && first + last < best) {
+          best = first + last;
+        }
+      }
+      if (best != inf) {
+        dists[u][v] = best - potentials[u] + potentials[v];
+      }
+    }
+  });
+
+  return dists;
+}
+
+template <typename T>
+SymmetricMatrix GraphAlgorithms<T>::symmetric_floyd_warshall(const Graph<int>& g, AlgorithmStats* stats) {
+  const int inf = std::numeric_limits<int>::max();
+  int n = g.node_count();
+  if (g.is_directed()) {
+    return SymmetricMatrix();
+  }
+
+  SymmetricMatrix d(n);
+  APSP_STAT(stats, bytes_allocated, d.packed().capacity() * sizeof(int) + n * sizeof(int));
+  for (int u = 0; u < n; u++) {
+    d.at(u, u) = 0;
+    for (const auto& [label, v] : g.out_edges(u)) {
+      if (label.value() < 0) {
+        return SymmetricMatrix();  // negative cycle (u,v,u)
+      }
+      if (v != u) {
+        d.at(u, v) = std::min(d.at(u, v), label.value());
+      }
+    }
+  }
+
+  // column k doesn't change during phase k, so it is read from a
+  // contiguous copy (entry i is d(i,k))
+  vector<int> pivot(n);
+  for (int k = 0; k < n; k++) {
+    APSP_STAT(stats, pivot_phases, 1);
+    for (int i = 0; i < n; i++) {
+      pivot[i] = d.at(i, k);
+    }
+    for (int i = 0; i < n; i++) {
+      int ik = pivot[i];
+      if (ik == inf) {
+        continue;
+      }
+      // row i of the triangle, indexed by j >= i
+      int* row = d.packed().data() + d.row_offset(i) - i;
+      APSP_STAT(stats, relaxations, n - i);
+      for (int j = i; j < n; j++) {
+        if (pivot[j] != inf && (long long) ik + pivot[j] < row[j]) {
+          row[j] = ik + pivot[j];
+          APSP_STAT(stats, successful_relaxations, 1);
+        }
+      }
+    }
+  }
+
+  return d;
+}
+
+template <typename T>
+SymmetricMatrix GraphAlgorithms<T>::symmetric_apsp(const Graph<int>& g, AlgorithmStats* stats) {
+  const long long inf = std::numeric_limits<long long>::max();
+  int n = g.node_count();
+  if (g.is_directed()) {
+    return SymmetricMatrix();
+  }
+  StaticGraph sg(g);
+  for (int u = 0; u < n; u++) {
+    for (const auto& arc : sg.out_arcs(u)) {
+      if (arc.label < 0) {
+        return SymmetricMatrix();  // negative cycle (u,v,u)
+      }
+    }
+  }
+
+  SymmetricMatrix d(n);
+  vector<long long> dist(n, inf);
+  vector<bool> settled(n, false);
+  vector<int> touched;
+  std::priority_queue<pair<long long,int>, vector<pair<long long,int>>, std::greater<pair<long long,int>>> heap;
+  APSP_STAT(stats, bytes_allocated, d.packed().capacity() * sizeof(int) + dist.capacity() * sizeof(long long)
+            + n / 8);
+
+  for (int s = 0; s < n; s++) {
+    // dijkstra until every vertex after s is settled
+    int remaining = n - 1 - s;
+    int* row = d.packed().data() + d.row_offset(s) - s;
+    dist[s] = 0;
+    touched.push_back(s);
+    heap.push(std::make_pair(0LL, s));
+    APSP_STAT(stats, heap_pushes, 1);
+    while (!heap.empty() && remaining > 0) {
+      auto [du, u] = heap.top();
+      heap.pop();
+      APSP_STAT(stats, heap_pops, 1);
+      if (settled[u]) {
+        continue;  // stale entry
+      }
+      settled[u] = true;
+      if (u > s) {
+        row[u] = du;
+        remaining--;
+      }
+
+      for (const auto& arc : sg.out_arcs(u)) {
+        APSP_STAT(stats, relaxations, 1);
+        if (du + arc.label < dist[arc.node]) {
+          if (dist[arc.node] == inf) {
+            touched.push_back(arc.node);
+          }
+          dist[arc.node] = du + arc.label;
+          heap.push(std::make_pair(dist[arc.node], arc.node));
+          APSP_STAT(stats, successful_relaxations, 1);
+          APSP_STAT(stats, heap_pushes, 1);
+        }
+      }
+    }
+    row[s] = 0;
+
+    for (int u : touched) {
+      dist[u] = inf;
+      settled[u] = false;
+    }
+    touched.clear();
+    heap = decltype(heap)();
+  }
+
+  return d;
+}
+
+template <typename T>
+int GraphAlgorithms<T>::uniform_edge_label(const Graph<int>& g) {
+  int shared = -1;
+  for (int u = 0; u < g.node_count(); u++) {
+    for (const auto& [label, v] : g.out_edges(u)) {
+      if (shared >= 0 && label.value() != shared) {
+        return -1;
+      }
+      shared = label.value();
+      if (shared < 0) {
+        return -1;
+      }
+    }
+  }
+  return shared < 0 ? 1 : shared;
+}
+
+template <typename T>
+vector<vector<int>> GraphAlgorithms<T>::bit_parallel_apsp(const Graph<int>& g, int threads, AlgorithmStats* stats) {
+  // words per bitset, so a batch has 64 * words sources
+  const int words = 4;
+  const int batch = 64 * words;
+  int n = g.node_count();
+  int label = uniform_edge_label(g);
+  if (label < 0) {
+    return vector<vector<int>>();
+  }
+  StaticGraph sg(g);
+
+  vector<vector<int>> dists(n, vector<int>(n, std::numeric_limits<int>::max()));
+  APSP_STAT(stats, bytes_allocated, (long long) n * n * sizeof(int));
+
+  parallel_for((n + batch - 1) / batch, threads, stats, [&](int b, AlgorithmStats* counts) {
+    int first = b * batch;
+    int last = std::min(n, first + batch);
+
+    // bitsets of vertex v are words [v * words, (v + 1) * words)
+    vector<uint64_t> visited((long long) n * words, 0);
+    vector<uint64_t> frontier((long long) n * words, 0);
+    vector<uint64_t> next((long long) n * words, 0);
+    vector<bool> in_next(n, false);
+    vector<int> frontier_list;
+    vector<int> next_list;
+    APSP_STAT(counts, bytes_allocated, 3LL * n * words * sizeof(uint64_t) + n / 8);
+
+    for (int s = first; s < last; s++) {
+      uint64_t bit = 1ULL << ((s - first) % 64);
+      visited[(long long) s * words + (s - first) / 64] |= bit;
+      frontier[(long long) s * words + (s - first) / 64] |= bit;
+      frontier_list.push_back(s);
+      dists[s][s] = 0;
+    }
+
+    for (long long level = 1; !frontier_list.empty(); level++) {
+      // push every frontier bitset along the out edges
+      for (int u : frontier_list) {
+        const uint64_t* from = frontier.data() + (long long) u * words;
+        for (const auto& arc : sg.out_arcs(u)) {
+          APSP_STAT(counts, relaxations, 1);
+          uint64_t* to = next.data() + (long long) arc.node * words;
+          for (int w = 0; w < words; w++) {
+            to[w] |= from[w];
+          }
+          if (!in_next[arc.node]) {
+            in_next[arc.node] = true;
+            next_list.push_back(arc.node);
+          }
+        }
+        std::fill(frontier.begin() + (long long) u * words, frontier.begin() + (long long) (u + 1) * words, 0);
+      }
+      frontier_list.clear();
+
+      // keep the sources that reach v for the first time
+      int cost = level * label;
+      for (int v : next_list) {
+        in_next[v] = false;
+        uint64_t* reached = next.data() + (long long) v * words;
+        uint64_t* seen = visited.data() + (long long) v * words;
+        uint64_t* fresh = frontier.data() + (long long) v * words;
+        uint64_t any = 0;
+        for (int w = 0; w < words; w++) {
+          fresh[w] = reached[w] & ~seen[w];
+          seen[w] |= fresh[w];
+          reached[w] = 0;
+          any |= fresh[w];
+        }
+        if (!any) {
+          continue;
+        }
+        frontier_list.push_back(v);
+        for (int w = 0; w < words; w++) {
+          for (uint64_t bits = fresh[w]; bits; bits &= bits - 1) {
+            dists[first + w * 64 + __builtin_ctzll(bits)][v] = cost;
+            APSP_STAT(counts, successful_relaxations, 1);
+          }
+        }
+      }
+      next_list.clear();
+    }
+  });
+
+  return dists;
+}
+
 
 #endif
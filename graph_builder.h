@@ -0,0 +1,166 @@
+//----------------------------------------------------------------------
+// FILE: graph_builder.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Bulk builder for adjacency list graphs. Edges are collected
+//       in batches and the finished graph is created in one step,
+//       without the per-edge duplicate check (and linear scan) done by
+//       AdjacencyList::add_edge.
+//----------------------------------------------------------------------
+
+
+#ifndef GRAPH_BUILDER_H
+#define GRAPH_BUILDER_H
+
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <algorithm>
+#include "adjacency_list.h"
+
+
+template<typename T>
+class GraphBuilder
+{
+public:
+
+  // constructor for a graph with n nodes
+  GraphBuilder(int n, bool is_directed);
+
+  // Queues the edge (x,y) with the given (optional) label. Edges with
+  // invalid nodes are ignored. If the edge is queued more than once,
+  // the first label is kept (as with AdjacencyList::add_edge).
+  void add_edge(int x, std::optional<T> label, int y);
+
+  // Queues a batch of (x, label, y) edges in order
+  void add_edges(const std::vector<std::tuple<int,T,int>>& edges);
+
+  // Returns the number of queued edges (including duplicates)
+  size_t queued_count() const;
+
+  // Sorts and deduplicates the queued edges and returns the finished
+  // graph, using the given allocator for its edges. Sorting within
+  // each source node is split across the given number of threads (0 =
+  // one per core). The builder is empty afterwards.
+  template<typename Alloc = std::allocator<std::pair<std::optional<T>,int>>>
+  AdjacencyList<T,Alloc> build(int threads = 1, const Alloc& alloc = Alloc());
+
+private:
+  // a queued edge (for undirected graphs x <= y)
+  struct Entry
+  {
+    int x;
+    int y;
+    std::optional<T> label;
+  };
+
+  int nodes;
+  bool directed;
+  std::vector<Entry> entries;
+};
+
+
+template<typename T>
+GraphBuilder<T>::GraphBuilder(int n, bool is_directed) {
+  nodes = n;
+  directed = is_directed;
+}
+
+template<typename T>
+void GraphBuilder<T>::add_edge(int x, std::optional<T> label, int y) {
+  // check for invalid nodes
+  if (x < 0 || x >= nodes || y < 0 || y >= nodes) {
+    return;
+  }
+
+  // (x,y) and (y,x) are the same undirected edge
+  if (!directed && y < x) {
+    std::swap(x, y);
+  }
+  entries.push_back(Entry{x, y, label});
+}
+
+template<typename T>
+void GraphBuilder<T>::add_edges(const std::vector<std::tuple<int,T,int>>& edges) {
+  entries.reserve(entries.size() + edges.size());
+  for (const auto& [x, label, y] : edges) {
+    add_edge(x, label, y);
+  }
+}
+
+template<typename T>
+size_t GraphBuilder<T>::queued_count() const {
+  return entries.size();
+}
+
+template<typename T>
+template<typename Alloc>
+AdjacencyList<T,Alloc> GraphBuilder<T>::build(int threads, const Alloc& alloc) {
+  // stable counting sort by x, so each source node's edges are
+  // contiguous and still in insertion order
+  std::vector<size_t> start(nodes + 1, 0);
+  for (const Entry& e : entries) {
+    start[e.x + 1]++;
+  }
+  for (int x = 0; x < nodes; x++) {
+    start[x + 1] += start[x];
+  }
+  std::vector<Entry> sorted(entries.size());
+  std::vector<size_t> fill(start.begin(), start.end() - 1);
+  for (const Entry& e : entries) {
+    sorted[fill[e.x]++] = e;
+  }
+  entries.clear();
+  entries.shrink_to_fit();
+
+  // stable sort each node's edges by y and drop later duplicates
+  std::vector<size_t> end(nodes);
+  auto sort_node = [&](int x) {
+    auto first = sorted.begin() + start[x];
+    auto last = sorted.begin() + start[x + 1];
+    std::stable_sort(first, last, [](const Entry& a, const Entry& b) { return a.y < b.y; });
+    auto unique_last = std::unique(first, last, [](const Entry& a, const Entry& b) { return a.y == b.y; });
+    end[x] = unique_last - sorted.begin();
+  };
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (threads == 1 || nodes < 2) {
+    for (int x = 0; x < nodes; x++) {
+      sort_node(x);
+    }
+  } else {
+    std::atomic<int> next_node(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&]() {
+        for (int x = next_node++; x < nodes; x = next_node++) {
+          sort_node(x);
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  // emit the graph
+  AdjacencyList<T,Alloc> g(nodes, directed, alloc);
+  for (int x = 0; x < nodes; x++) {
+    for (size_t i = start[x]; i < end[x]; i++) {
+      const Entry& e = sorted[i];
+      g.adj_list[x].push_back(std::make_pair(e.label, e.y));
+      if (!directed) {
+        g.adj_list[e.y].push_back(std::make_pair(e.label, x));
+      }
+      g.edges++;
+    }
+  }
+
+  return g;
+}
+
+
+#endif
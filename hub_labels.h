@@ -0,0 +1,472 @@
+//----------------------------------------------------------------------
+// FILE: hub_labels.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: 2-hop hub labeling distance oracle built by pruned landmark
+//       labeling. Every node x gets a forward label (hubs h with the
+//       distance x to h) and a backward label (hubs h with the
+//       distance h to x), both sorted by hub, such that every shortest
+//       s-t path passes through a hub in both the forward label of s
+//       and the backward label of t. A query is then a merge of two
+//       short sorted arrays. Assumes non-negative edge labels.
+//----------------------------------------------------------------------
+
+
+#ifndef HUB_LABELS_H
+#define HUB_LABELS_H
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <thread>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <algorithm>
+#include <functional>
+#include "graph.h"
+#include "static_graph.h"
+
+
+// label size statistics for a hub label index
+struct HubLabelStats
+{
+  long long entries = 0;      // total (hub, distance) entries in all labels
+  double average_size = 0;    // average entries per label (forward and backward)
+  int max_size = 0;           // largest single label
+  long long bytes = 0;        // memory used by the label arrays
+};
+
+
+class HubLabels
+{
+public:
+
+  // constructor for an empty index (e.g., to read into)
+  HubLabels();
+
+  // Constructor that builds the labels for g. Hubs are processed in
+  // batches of the given number of threads (0 = one per core), each
+  // batch pruning only against the labels of earlier batches. One
+  // thread gives the (smallest) sequential labeling.
+  HubLabels(const Graph<int>& g, int threads = 1);
+
+  // Returns the shortest path cost from s to t, or
+  // numeric_limits<int>::max() if t is unreachable from s.
+  int distance(int s, int t) const;
+
+  // Returns the total number of nodes in the graph.
+  int node_count() const;
+
+  // Returns the label size statistics
+  HubLabelStats stats() const;
+
+  // Writes the labels in a compact binary format. Returns false if the
+  // stream failed.
+  bool write(std::ostream& out) const;
+
+  // Replaces the labels with ones read by write(). Returns false (and
+  // leaves the index empty) if the data is malformed.
+  bool read(std::istream& in);
+
+private:
+  // labels of node x are in [offsets[x], offsets[x+1]) of the hub and
+  // distance arrays, sorted by hub (a hub is its rank in the order)
+  struct LabelSet
+  {
+    std::vector<long long> offsets;
+    std::vector<int> hubs;
+    std::vector<int> dists;
+  };
+
+  typedef std::pair<long long,int> Entry;  // (distance, node)
+  typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> MinHeap;
+
+  int nodes;
+  LabelSet forward;   // x -> hub
+  LabelSet backward;  // hub -> x
+
+  // label entries found by the searches from one hub
+  struct Found
+  {
+    std::vector<int> forward_nodes;
+    std::vector<int> forward_dists;
+    std::vector<int> backward_nodes;
+    std::vector<int> backward_dists;
+  };
+
+  // Runs the two pruned dijkstras from the node with rank hub, checking
+  // against the current working labels
+  static void search(const StaticGraph& sg, const std::vector<int>& order, int hub,
+                     const std::vector<std::vector<std::pair<int,int>>>& forward_labels,
+                     const std::vector<std::vector<std::pair<int,int>>>& backward_labels,
+                     std::vector<long long>& hub_dist, std::vector<long long>& dist,
+                     std::vector<int>& touched, Found& found);
+
+  // Returns the nodes in hub order: most shortest path tree descendants
+  // (summed over a sample of roots) first, then by degree. This
+  // approximates betweenness, which gives much smaller labels than
+  // degree alone on road-like graphs.
+  static std::vector<int> hub_order(const StaticGraph& sg);
+
+  // flattens working labels into a label set
+  static void flatten(const std::vector<std::vector<std::pair<int,int>>>& labels, LabelSet& set);
+
+  // reads count ints into values, growing it only as the data arrives
+  // (so a corrupt count can't force a huge allocation). Returns false
+  // if the stream ends first.
+  static bool read_ints(std::istream& in, std::vector<int>& values, long long count);
+};
+
+
+inline HubLabels::HubLabels() : nodes(0) {
+  forward.offsets.assign(1, 0);
+  backward.offsets.assign(1, 0);
+}
+
+inline HubLabels::HubLabels(const Graph<int>& g, int threads) : nodes(g.node_count()) {
+  StaticGraph sg(g);
+
+  std::vector<int> order = hub_order(sg);
+
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::max(1, std::min(threads, nodes));
+
+  // working labels: (hub, distance) pairs, appended in hub order
+  std::vector<std::vector<std::pair<int,int>>> forward_labels(nodes);
+  std::vector<std::vector<std::pair<int,int>>> backward_labels(nodes);
+
+  // per thread search buffers
+  std::vector<std::vector<long long>> hub_dist(threads, std::vector<long long>(nodes, -1));
+  std::vector<std::vector<long long>> dist(threads, std::vector<long long>(nodes, -1));
+  std::vector<std::vector<int>> touched(threads);
+  std::vector<Found> found(threads);
+
+  for (int first = 0; first < nodes; first += threads) {
+    int batch = std::min(threads, nodes - first);
+    if (batch == 1) {
+      search(sg, order, first, forward_labels, backward_labels, hub_dist[0], dist[0], touched[0], found[0]);
+    } else {
+      std::vector<std::thread> workers;
+      for (int t = 0; t < batch; t++) {
+        workers.emplace_back([&, t]() {
+          search(sg, order, first + t, forward_labels, backward_labels, hub_dist[t], dist[t], touched[t], found[t]);
+        });
+      }
+      for (auto& worker : workers) {
+        worker.join();
+      }
+    }
+
+    // append the batch's entries in hub order (keeps labels sorted)
+    for (int t = 0; t < batch; t++) {
+      Found& f = found[t];
+      for (size_t i = 0; i < f.forward_nodes.size(); i++) {
+        forward_labels[f.forward_nodes[i]].push_back(std::make_pair(first + t, f.forward_dists[i]));
+      }
+      for (size_t i = 0; i < f.backward_nodes.size(); i++) {
+        backward_labels[f.backward_nodes[i]].push_back(std::make_pair(first + t, f.backward_dists[i]));
+      }
+    }
+  }
+
+  flatten(forward_labels, forward);
+  flatten(backward_labels, backward);
+}
+
+inline std::vector<int> HubLabels::hub_order(const StaticGraph& sg) {
+  int n = sg.node_count();
+  const int samples = 16;
+
+  std::vector<long long> score(n, 0);
+  std::vector<long long> dist(n);
+  std::vector<int> parent(n);
+  std::vector<int> settled;
+  std::vector<long long> descendants(n);
+  for (int i = 0; i < samples && i < n; i++) {
+    // roots spread evenly over the node ids
+    int root = (long long) i * n / std::min(samples, n);
+    std::fill(dist.begin(), dist.end(), -1);
+    settled.clear();
+    MinHeap heap;
+    dist[root] = 0;
+    parent[root] = -1;
+    heap.push(Entry(0, root));
+    while (!heap.empty()) {
+      auto [d, x] = heap.top();
+      heap.pop();
+      if (d > dist[x]) {
+        continue;
+      }
+      settled.push_back(x);
+      for (const auto& arc : sg.out_arcs(x)) {
+        if (dist[arc.node] < 0 || d + arc.label < dist[arc.node]) {
+          dist[arc.node] = d + arc.label;
+          parent[arc.node] = x;
+          heap.push(Entry(dist[arc.node], arc.node));
+        }
+      }
+    }
+
+    // subtree sizes, children before parents
+    for (int x : settled) {
+      descendants[x] = 1;
+    }
+    for (auto it = settled.rbegin(); it != settled.rend(); ++it) {
+      score[*it] += descendants[*it];
+      if (parent[*it] >= 0) {
+        descendants[parent[*it]] += descendants[*it];
+      }
+    }
+  }
+
+  std::vector<int> order(n);
+  for (int x = 0; x < n; x++) {
+    order[x] = x;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    if (score[a] != score[b]) {
+      return score[a] > score[b];
+    }
+    return sg.out_arcs(a).size() + sg.in_arcs(a).size() > sg.out_arcs(b).size() + sg.in_arcs(b).size();
+  });
+  return order;
+}
+
+inline void HubLabels::search(const StaticGraph& sg, const std::vector<int>& order, int hub,
+                              const std::vector<std::vector<std::pair<int,int>>>& forward_labels,
+                              const std::vector<std::vector<std::pair<int,int>>>& backward_labels,
+                              std::vector<long long>& hub_dist, std::vector<long long>& dist,
+                              std::vector<int>& touched, Found& found) {
+  int h = order[hub];
+  found = Found();
+
+  // two passes: hub -> x (backward labels of x), then x -> hub
+  // (forward labels of x)
+  for (int pass = 0; pass < 2; pass++) {
+    bool from_hub = pass == 0;
+    const auto& hub_label = from_hub ? forward_labels[h] : backward_labels[h];
+    const auto& node_labels = from_hub ? backward_labels : forward_labels;
+    std::vector<int>& found_nodes = from_hub ? found.backward_nodes : found.forward_nodes;
+    std::vector<int>& found_dists = from_hub ? found.backward_dists : found.forward_dists;
+
+    // the hub's own label, indexed by hub
+    for (const auto& [r, d] : hub_label) {
+      hub_dist[r] = d;
+    }
+
+    MinHeap heap;
+    dist[h] = 0;
+    touched.push_back(h);
+    heap.push(Entry(0, h));
+    while (!heap.empty()) {
+      auto [d, x] = heap.top();
+      heap.pop();
+      if (d > dist[x]) {
+        continue;
+      }
+
+      // prune if an earlier hub already covers this distance
+      bool covered = false;
+      for (const auto& [r, label_dist] : node_labels[x]) {
+        if (hub_dist[r] >= 0 && hub_dist[r] + label_dist <= d) {
+          covered = true;
+          break;
+        }
+      }
+      if (covered) {
+        continue;
+      }
+      found_nodes.push_back(x);
+      found_dists.push_back(d);
+
+      auto arcs = from_hub ? sg.out_arcs(x) : sg.in_arcs(x);
+      for (const auto& arc : arcs) {
+        long long next = d + arc.label;
+        if (dist[arc.node] < 0 || next < dist[arc.node]) {
+          if (dist[arc.node] < 0) {
+            touched.push_back(arc.node);
+          }
+          dist[arc.node] = next;
+          heap.push(Entry(next, arc.node));
+        }
+      }
+    }
+
+    for (int x : touched) {
+      dist[x] = -1;
+    }
+    touched.clear();
+    for (const auto& [r, d] : hub_label) {
+      hub_dist[r] = -1;
+    }
+  }
+}
+
+inline void HubLabels::flatten(const std::vector<std::vector<std::pair<int,int>>>& labels, LabelSet& set) {
+  set.offsets.assign(labels.size() + 1, 0);
+  set.hubs.clear();
+  set.dists.clear();
+  for (size_t x = 0; x < labels.size(); x++) {
+    for (const auto& [r, d] : labels[x]) {
+      set.hubs.push_back(r);
+      set.dists.push_back(d);
+    }
+    set.offsets[x + 1] = set.hubs.size();
+  }
+}
+
+inline int HubLabels::distance(int s, int t) const {
+  if (s < 0 || s >= nodes || t < 0 || t >= nodes) {
+    return std::numeric_limits<int>::max();
+  }
+
+  // merge the forward label of s with the backward label of t
+  long long i = forward.offsets[s];
+  long long i_end = forward.offsets[s + 1];
+  long long j = backward.offsets[t];
+  long long j_end = backward.offsets[t + 1];
+  long long best = std::numeric_limits<long long>::max();
+  while (i < i_end && j < j_end) {
+    int a = forward.hubs[i];
+    int b = backward.hubs[j];
+    if (a == b) {
+      best = std::min(best, (long long) forward.dists[i] + backward.dists[j]);
+      i++;
+      j++;
+    } else if (a < b) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+
+  return best == std::numeric_limits<long long>::max() ? std::numeric_limits<int>::max() : best;
+}
+
+inline int HubLabels::node_count() const {
+  return nodes;
+}
+
+inline HubLabelStats HubLabels::stats() const {
+  HubLabelStats result;
+  result.entries = forward.hubs.size() + backward.hubs.size();
+  if (nodes > 0) {
+    result.average_size = (double) result.entries / (2.0 * nodes);
+  }
+  for (int x = 0; x < nodes; x++) {
+    result.max_size = std::max(result.max_size, (int) (forward.offsets[x + 1] - forward.offsets[x]));
+    result.max_size = std::max(result.max_size, (int) (backward.offsets[x + 1] - backward.offsets[x]));
+  }
+  for (const LabelSet* set : {&forward, &backward}) {
+    result.bytes += set->offsets.size() * sizeof(long long);
+    result.bytes += set->hubs.size() * sizeof(int) + set->dists.size() * sizeof(int);
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------
+// Binary format (native byte order): the magic "HUBL", the node count,
+// then for the forward and backward labels the entry count followed by
+// the label sizes and the (hub, distance) entries as int arrays.
+//----------------------------------------------------------------------
+
+inline bool HubLabels::write(std::ostream& out) const {
+  out.write("HUBL", 4);
+  out.write(reinterpret_cast<const char*>(&nodes), sizeof(int));
+  for (const LabelSet* set : {&forward, &backward}) {
+    long long entries = set->hubs.size();
+    out.write(reinterpret_cast<const char*>(&entries), sizeof(long long));
+    for (int x = 0; x < nodes; x++) {
+      int size = set->offsets[x + 1] - set->offsets[x];
+      out.write(reinterpret_cast<const char*>(&size), sizeof(int));
+    }
+    out.write(reinterpret_cast<const char*>(set->hubs.data()), entries * sizeof(int));
+    out.write(reinterpret_cast<const char*>(set->dists.data()), entries * sizeof(int));
+  }
+  return bool(out);
+}
+
+inline bool HubLabels::read(std::istream& in) {
+  *this = HubLabels();
+  char magic[4];
+  int n = 0;
+  in.read(magic, 4);
+  in.read(reinterpret_cast<char*>(&n), sizeof(int));
+  if (!in || std::string(magic, 4) != "HUBL" || n < 0) {
+    return false;
+  }
+  // the rest holds an entry count and n label sizes per set, so a
+  // corrupt n is caught before anything is allocated for it (if the
+  // stream can tell how much is left)
+  long long remaining = -1;
+  std::streampos here = in.tellg();
+  if (here != std::streampos(-1) && in.seekg(0, std::ios::end)) {
+    remaining = in.tellg() - here;
+    in.seekg(here);
+  }
+  in.clear();
+  if (remaining >= 0 && 2 * (sizeof(long long) + (long long) n * sizeof(int)) > (unsigned long long) remaining) {
+    return false;
+  }
+
+  LabelSet sets[2];
+  for (LabelSet& set : sets) {
+    long long entries = 0;
+    in.read(reinterpret_cast<char*>(&entries), sizeof(long long));
+    // a label holds each hub at most once
+    if (!in || entries < 0 || entries > (long long) n * n) {
+      return false;
+    }
+    if (remaining >= 0 && entries > remaining / (2 * (long long) sizeof(int))) {
+      return false;
+    }
+    std::vector<int> sizes;
+    if (!read_ints(in, sizes, n)) {
+      return false;
+    }
+    set.offsets.assign(n + 1, 0);
+    for (int x = 0; x < n; x++) {
+      if (sizes[x] < 0 || sizes[x] > n) {
+        return false;
+      }
+      set.offsets[x + 1] = set.offsets[x] + sizes[x];
+    }
+    if (set.offsets[n] != entries || !read_ints(in, set.hubs, entries) || !read_ints(in, set.dists, entries)) {
+      return false;
+    }
+    for (int x = 0; x < n; x++) {
+      for (long long i = set.offsets[x]; i < set.offsets[x + 1]; i++) {
+        bool sorted = i == set.offsets[x] || set.hubs[i - 1] < set.hubs[i];
+        if (set.hubs[i] < 0 || set.hubs[i] >= n || !sorted) {
+          return false;
+        }
+      }
+    }
+  }
+
+  nodes = n;
+  forward = std::move(sets[0]);
+  backward = std::move(sets[1]);
+  return true;
+}
+
+inline bool HubLabels::read_ints(std::istream& in, std::vector<int>& values, long long count) {
+  const long long chunk = 1 << 16;
+  values.clear();
+  while ((long long) values.size() < count) {
+    long long start = values.size();
+    long long size = std::min(chunk, count - start);
+    values.resize(start + size);
+    in.read(reinterpret_cast<char*>(values.data() + start), size * sizeof(int));
+    if (!in) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+#endif
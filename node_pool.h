@@ -0,0 +1,179 @@
+//----------------------------------------------------------------------
+// FILE: node_pool.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Node pool allocator for the per-edge list nodes of an
+//       AdjacencyList. Nodes are carved out of contiguous slabs, freed
+//       nodes go on a free list to be reused by the next allocation,
+//       and the slabs are released together when the last allocator
+//       sharing the pool goes away. Not thread safe: a pool should
+//       only be used by one graph (copies of a pooled graph get their
+//       own pool).
+//----------------------------------------------------------------------
+
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <new>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+
+class NodePool
+{
+public:
+
+  // constructor for nodes of the given size, allocating slabs_nodes
+  // nodes per slab
+  NodePool(size_t node_size, size_t slab_nodes = 1024);
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  // returns memory for one node
+  void* allocate();
+
+  // returns the node to the free list
+  void deallocate(void* p);
+
+  // returns the size of a node
+  size_t node_size() const;
+
+  // returns the total bytes held in slabs
+  size_t capacity_bytes() const;
+
+private:
+  // free nodes are linked through their first bytes
+  struct FreeNode
+  {
+    FreeNode* next;
+  };
+
+  size_t size;
+  size_t per_slab;
+  std::vector<std::unique_ptr<std::byte[]>> slabs;
+  std::byte* next_unused = nullptr;  // next never-used node in the newest slab
+  std::byte* slab_end = nullptr;
+  FreeNode* free_list = nullptr;
+};
+
+
+inline NodePool::NodePool(size_t node_size, size_t slab_nodes) {
+  // round up so every node is suitably aligned
+  size_t align = alignof(std::max_align_t);
+  size = std::max(node_size, sizeof(FreeNode));
+  size = (size + align - 1) / align * align;
+  per_slab = slab_nodes > 0 ? slab_nodes : 1;
+}
+
+inline void* NodePool::allocate() {
+  // reuse freed nodes first
+  if (free_list) {
+    FreeNode* node = free_list;
+    free_list = node->next;
+    return node;
+  }
+
+  // start a new slab when the current one is used up
+  if (next_unused == slab_end) {
+    slabs.emplace_back(new std::byte[size * per_slab]);
+    next_unused = slabs.back().get();
+    slab_end = next_unused + size * per_slab;
+  }
+  void* p = next_unused;
+  next_unused += size;
+  return p;
+}
+
+inline void NodePool::deallocate(void* p) {
+  FreeNode* node = static_cast<FreeNode*>(p);
+  node->next = free_list;
+  free_list = node;
+}
+
+inline size_t NodePool::node_size() const {
+  return size;
+}
+
+inline size_t NodePool::capacity_bytes() const {
+  return slabs.size() * size * per_slab;
+}
+
+
+//----------------------------------------------------------------------
+// Standard allocator over a shared NodePool. Single-object allocations
+// of the (rebound) node type come from the pool; anything else falls
+// back to operator new. Copies and rebinds share the same pool, except
+// that copying a container (select_on_container_copy_construction)
+// starts a new pool.
+//----------------------------------------------------------------------
+
+template<typename U>
+class PoolAllocator
+{
+public:
+  typedef U value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  // constructor that creates a new, empty pool
+  PoolAllocator() {}
+
+  template<typename V>
+  PoolAllocator(const PoolAllocator<V>& other) : pool(other.pool) {}
+
+  U* allocate(size_t n) {
+    if (n != 1) {
+      return static_cast<U*>(::operator new(n * sizeof(U)));
+    }
+    if (!*pool) {
+      *pool = std::make_unique<NodePool>(sizeof(U));
+    }
+    if ((*pool)->node_size() < sizeof(U)) {
+      return static_cast<U*>(::operator new(sizeof(U)));
+    }
+    return static_cast<U*>((*pool)->allocate());
+  }
+
+  void deallocate(U* p, size_t n) {
+    if (n != 1 || !*pool || (*pool)->node_size() < sizeof(U)) {
+      ::operator delete(p);
+      return;
+    }
+    (*pool)->deallocate(p);
+  }
+
+  PoolAllocator select_on_container_copy_construction() const {
+    return PoolAllocator();
+  }
+
+  // returns the bytes held by the pool's slabs
+  size_t pool_bytes() const {
+    return *pool ? (*pool)->capacity_bytes() : 0;
+  }
+
+  template<typename V>
+  bool operator==(const PoolAllocator<V>& other) const {
+    return pool == other.pool;
+  }
+
+  template<typename V>
+  bool operator!=(const PoolAllocator<V>& other) const {
+    return pool != other.pool;
+  }
+
+private:
+  template<typename V>
+  friend class PoolAllocator;
+
+  // the pool is created on the first node allocation, once the node
+  // type (after rebinding) is known
+  std::shared_ptr<std::unique_ptr<NodePool>> pool = std::make_shared<std::unique_ptr<NodePool>>();
+};
+
+
+#endif
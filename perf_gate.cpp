@@ -0,0 +1,347 @@
+//---------------------------------------------------------------------------
+// NAME: Zach Sahlin
+// FILE: perf_gate.cpp
+// DATE: Fall 2022
+// DESC: Performance regression gate. Compares timing results in the
+//       perf_output.dat column format against a stored baseline in the
+//       same format and fails if any cell (column and node count) got
+//       slower than the noise threshold. Rows that repeat a node count
+//       are treated as repeated samples of the same cell. To run the
+//       benchmark five times and compare against the baseline use:
+//          ./perf_gate --run ./final_perf --repeat 5 perf_baseline.dat
+//       To compare an existing results file instead use:
+//          ./perf_gate --current perf_output.dat perf_baseline.dat
+//       To record a new baseline use:
+//          ./perf_gate --run ./final_perf --repeat 5 --save perf_baseline.dat
+//       A cell is a regression when its median slowed down by more than
+//       the threshold AND a one-sided Mann-Whitney U test says the
+//       slowdown is significant. Cells that are small for their column
+//       (both medians under the floor fraction of the column's largest
+//       baseline median) are too noisy to judge and are skipped. Since
+//       a single cell holds only a few noisy samples, each column is
+//       also checked as a whole: it regressed when the geometric mean
+//       of its checked cells' median ratios is over the threshold AND a
+//       one-sided sign test says that significantly many of them got
+//       slower. Exits with 1 if any cell or column regressed.
+//---------------------------------------------------------------------------
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+
+// gate parameters (defaults)
+double threshold = 0.25;   // tolerated relative slowdown of the median
+double alpha = 0.01;       // significance level of the u test
+double floor_value = 0.1;  // cells with both medians below this fraction
+                           // of their column's largest baseline median
+                           // are skipped
+int repeat = 5;            // number of benchmark runs with --run
+
+
+// results in the perf_output.dat format: the column names from the
+// "# Column k = name" header lines and, for each (column, node count)
+// cell, every sample taken
+struct Results
+{
+  map<int,string> names;
+  map<pair<int,int>,vector<double>> samples;
+};
+
+
+//----------------------------------------------------------------------
+// Parsing
+//----------------------------------------------------------------------
+
+void parse_results(istream& in, Results& results, ostream* echo)
+{
+  string line;
+  while (getline(in, line)) {
+    if (echo)
+      *echo << line << "\n";
+    if (line.empty())
+      continue;
+    if (line[0] == '#') {
+      int column;
+      char name[256];
+      if (sscanf(line.c_str(), "# Column %d = %255[^\n]", &column, name) == 2)
+        results.names[column] = name;
+      continue;
+    }
+    istringstream row(line);
+    int n;
+    if (!(row >> n))
+      continue;
+    string value;
+    int column = 2;
+    while (row >> value) {
+      double x = strtod(value.c_str(), nullptr);
+      if (!isnan(x))
+        results.samples[{column, n}].push_back(x);
+      ++column;
+    }
+  }
+}
+
+bool read_file(const string& path, Results& results)
+{
+  ifstream in(path);
+  if (!in)
+    return false;
+  parse_results(in, results, nullptr);
+  return true;
+}
+
+bool run_benchmark(const string& command, Results& results, ostream* echo)
+{
+  for (int i = 0; i < repeat; ++i) {
+    cerr << "perf_gate: run " << (i + 1) << "/" << repeat << ": " << command << endl;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe)
+      return false;
+    string output;
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+      output.append(buffer, count);
+    if (pclose(pipe) != 0)
+      return false;
+    istringstream in(output);
+    // only keep the header of the first run in a saved baseline
+    ostringstream rows;
+    parse_results(in, results, echo ? &rows : nullptr);
+    if (echo) {
+      istringstream saved(rows.str());
+      string line;
+      while (getline(saved, line))
+        if (i == 0 || line.empty() || line[0] != '#')
+          *echo << line << "\n";
+    }
+  }
+  return true;
+}
+
+
+//----------------------------------------------------------------------
+// Statistics
+//----------------------------------------------------------------------
+
+double median(vector<double> xs)
+{
+  sort(xs.begin(), xs.end());
+  int m = xs.size();
+  if (m == 0)
+    return 0.0;
+  return m % 2 ? xs[m/2] : (xs[m/2 - 1] + xs[m/2]) / 2;
+}
+
+// One-sided Mann-Whitney U test that the current samples are larger
+// (slower) than the baseline samples. Uses the normal approximation
+// with tie and continuity corrections.
+// Returns: the p-value
+double mann_whitney_greater(const vector<double>& base, const vector<double>& cur)
+{
+  int n1 = base.size();
+  int n2 = cur.size();
+  if (n1 == 0 || n2 == 0)
+    return 1.0;
+
+  // rank the pooled samples, averaging the ranks of ties
+  vector<pair<double,int>> pooled;
+  for (double x : base)
+    pooled.push_back({x, 0});
+  for (double x : cur)
+    pooled.push_back({x, 1});
+  sort(pooled.begin(), pooled.end());
+  int total = pooled.size();
+  double cur_rank_sum = 0.0;
+  double tie_term = 0.0;
+  for (int i = 0; i < total; ) {
+    int j = i;
+    while (j < total && pooled[j].first == pooled[i].first)
+      ++j;
+    double rank = (i + 1 + j) / 2.0;
+    for (int k = i; k < j; ++k)
+      if (pooled[k].second == 1)
+        cur_rank_sum += rank;
+    double t = j - i;
+    tie_term += t * t * t - t;
+    i = j;
+  }
+
+  double u = cur_rank_sum - n2 * (n2 + 1) / 2.0;
+  double mean = n1 * n2 / 2.0;
+  double var = n1 * n2 / 12.0 * ((total + 1) - tie_term / (total * (total - 1.0)));
+  if (var <= 0)
+    return u > mean ? 0.0 : 1.0;
+  double z = (u - mean - 0.5) / sqrt(var);
+  return 0.5 * erfc(z / sqrt(2.0));
+}
+
+
+// one-sided sign test: the probability of at least slower of count
+// cells getting slower if each is equally likely to get faster
+double sign_test_greater(int slower, int count)
+{
+  double p = 0.0;
+  for (int k = slower; k <= count; ++k)
+    p += exp(lgamma(count + 1.0) - lgamma(k + 1.0) - lgamma(count - k + 1.0) - count * log(2.0));
+  return min(1.0, p);
+}
+
+
+//----------------------------------------------------------------------
+// Driver
+//----------------------------------------------------------------------
+
+void usage()
+{
+  cerr << "usage: perf_gate [--run CMD] [--repeat N] [--current FILE] [--save FILE]\n"
+       << "                 [--threshold X] [--alpha A] [--floor V] [baseline.dat]\n";
+}
+
+int main(int argc, char* argv[])
+{
+  string command, current_path, save_path, baseline_path;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--run" && has_value)
+      command = argv[++i];
+    else if (arg == "--repeat" && has_value)
+      repeat = atoi(argv[++i]);
+    else if (arg == "--current" && has_value)
+      current_path = argv[++i];
+    else if (arg == "--save" && has_value)
+      save_path = argv[++i];
+    else if (arg == "--threshold" && has_value)
+      threshold = atof(argv[++i]);
+    else if (arg == "--alpha" && has_value)
+      alpha = atof(argv[++i]);
+    else if (arg == "--floor" && has_value)
+      floor_value = atof(argv[++i]);
+    else if (arg[0] != '-' && baseline_path.empty())
+      baseline_path = arg;
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (command.empty() == current_path.empty() || repeat < 1 ||
+      (baseline_path.empty() && save_path.empty())) {
+    usage();
+    return 2;
+  }
+
+  // collect the current results
+  Results current;
+  if (!command.empty()) {
+    ofstream save;
+    if (!save_path.empty()) {
+      save.open(save_path);
+      if (!save) {
+        cerr << "perf_gate: cannot write " << save_path << endl;
+        return 2;
+      }
+    }
+    if (!run_benchmark(command, current, save_path.empty() ? nullptr : &save)) {
+      cerr << "perf_gate: benchmark command failed: " << command << endl;
+      return 2;
+    }
+  }
+  else if (!read_file(current_path, current)) {
+    cerr << "perf_gate: cannot read " << current_path << endl;
+    return 2;
+  }
+  if (baseline_path.empty())
+    return 0;
+
+  Results baseline;
+  if (!read_file(baseline_path, baseline)) {
+    cerr << "perf_gate: cannot read " << baseline_path << endl;
+    return 2;
+  }
+
+  // the skip floor of each column, relative to its largest cell, so
+  // every column is checked over its larger sizes whatever its scale
+  map<int,double> column_floor;
+  for (const auto& [cell, base] : baseline.samples)
+    column_floor[cell.first] = max(column_floor[cell.first], floor_value * median(base));
+
+  // compare each baseline cell
+  cout << fixed << setprecision(2);
+  cout << left << setw(44) << "cell" << right << setw(12) << "baseline" << setw(12) << "current"
+       << setw(10) << "change" << setw(8) << "p" << "  status" << endl;
+  int regressions = 0;
+  int missing = 0;
+  map<int,vector<double>> column_ratios;  // median ratios of checked cells
+  for (const auto& [cell, base] : baseline.samples) {
+    auto [column, n] = cell;
+    string name = baseline.names.count(column) ? baseline.names[column]
+                                               : "column " + to_string(column);
+    string label = name + " @ n=" + to_string(n);
+    auto it = current.samples.find(cell);
+    if (it == current.samples.end()) {
+      cout << left << setw(44) << label << right << setw(12) << median(base)
+           << setw(12) << "-" << setw(10) << "-" << setw(8) << "-" << "  MISSING" << endl;
+      ++missing;
+      continue;
+    }
+    double base_median = median(base);
+    double cur_median = median(it->second);
+    if (base_median < column_floor[column] && cur_median < column_floor[column])
+      continue;
+    double change = base_median > 0 ? cur_median / base_median - 1 : 0.0;
+    if (base_median > 0 && cur_median > 0)
+      column_ratios[column].push_back(cur_median / base_median);
+    double p = mann_whitney_greater(base, it->second);
+    bool regressed = change > threshold && p < alpha;
+    if (regressed)
+      ++regressions;
+    ostringstream change_str;
+    change_str << fixed << setprecision(1) << showpos << change * 100 << "%";
+    cout << left << setw(44) << label << right << setw(12) << base_median
+         << setw(12) << cur_median << setw(10) << change_str.str()
+         << setw(8) << setprecision(3) << p << setprecision(2)
+         << (regressed ? "  REGRESSION" : "  ok") << endl;
+  }
+
+  // compare each column over all of its checked cells
+  cout << endl;
+  for (const auto& [column, ratios] : column_ratios) {
+    string name = baseline.names.count(column) ? baseline.names[column]
+                                               : "column " + to_string(column);
+    double log_sum = 0.0;
+    int slower = 0;
+    for (double ratio : ratios) {
+      log_sum += log(ratio);
+      if (ratio > 1)
+        ++slower;
+    }
+    double change = exp(log_sum / ratios.size()) - 1;
+    double p = sign_test_greater(slower, ratios.size());
+    bool regressed = change > threshold && p < alpha;
+    if (regressed)
+      ++regressions;
+    ostringstream change_str;
+    change_str << fixed << setprecision(1) << showpos << change * 100 << "%";
+    cout << left << setw(44) << name + " (" + to_string(ratios.size()) + " cells)" << right
+         << setw(12) << "-" << setw(12) << "-" << setw(10) << change_str.str()
+         << setw(8) << setprecision(3) << p << setprecision(2)
+         << (regressed ? "  REGRESSION" : "  ok") << endl;
+  }
+
+  cout << endl << regressions << " regression(s), " << missing << " missing cell(s)"
+       << " (threshold " << threshold * 100 << "%, alpha " << alpha << ")" << endl;
+  return regressions > 0 || missing > 0 ? 1 : 0;
+}
@@ -0,0 +1,378 @@
+//----------------------------------------------------------------------
+// FILE: process_floyd_warshall.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Blocked Floyd-Warshall split across forked worker processes
+//       on one (POSIX) host. The distance matrix is cut into square
+//       tiles that are dealt out block-cyclically over a 2D grid of
+//       processes, and lives in a shared memory mapping together with
+//       a process-shared barrier. Each pivot block is done in the
+//       usual three phases (pivot tile, pivot row and column panels,
+//       everything else); before the last phase every process copies
+//       the panel tiles it needs once into private memory, the shared
+//       memory stand-in for a broadcast.
+//
+//       Everything a worker needs is allocated before forking, so the
+//       children only compute and exit. The caller watches the
+//       children from a separate thread and breaks the barrier if one
+//       of them dies, so the others stop instead of waiting for it.
+//----------------------------------------------------------------------
+
+
+#ifndef PROCESS_FLOYD_WARSHALL_H
+#define PROCESS_FLOYD_WARSHALL_H
+
+#include <new>
+#include <vector>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <csignal>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "graph.h"
+#include "algorithm_stats.h"
+
+
+//----------------------------------------------------------------------
+// Computes the shortest paths between all pairs of vertices using
+// blocked Floyd-Warshall on the given number of processes (the calling
+// process plus processes - 1 forked workers).
+// Input:
+//  g -- the given directed weighted graph
+//  processes -- number of processes, arranged in a grid as close to
+//               square as possible
+//  tile -- the side of a tile in vertices
+//  stats -- optional counters to add this run's operation counts to
+//           (only updated when compiled with APSP_STATS)
+// Output: the same table as GraphAlgorithms::floyd_warshall (empty if
+//         the graph has a negative cycle, or if a worker process could
+//         not be started or failed)
+//----------------------------------------------------------------------
+inline std::vector<std::vector<int>> process_floyd_warshall(const Graph<int>& g, int processes = 4, int tile = 64,
+                                                            AlgorithmStats* stats = nullptr);
+
+
+namespace process_fw {
+
+const int inf = std::numeric_limits<int>::max();
+
+// A process-shared barrier that can be broken, after which every wait
+// on it returns false. It is built on atomics and a futex on the
+// generation (polling where there are no futexes) rather than a pthread
+// barrier or condition variable, which can leave the other processes
+// blocked for good if one dies inside them.
+struct Barrier
+{
+  int count = 0;
+  std::atomic<int> waiting = 0;
+  std::atomic<unsigned> generation = 0;
+  std::atomic<bool> broken = false;
+};
+
+// header of the shared mapping (the matrix follows it)
+struct Shared
+{
+  Barrier barrier;
+  AlgorithmStats stats[64];  // per process counts
+};
+
+// a run's fixed layout
+struct Layout
+{
+  int n;
+  int tile;
+  int tiles;        // tiles per side
+  int rows;         // process grid
+  int cols;
+  int* matrix;      // n x n, row major
+  Shared* shared;
+};
+
+// a process's private buffers, allocated before forking
+struct Buffers
+{
+  Buffers(int n, int tile)
+    : row(n), col_panel((long long) n * tile), row_panel((long long) tile * n), col_rows(n), row_rows(n) {}
+
+  std::vector<int*> row;         // the matrix rows
+  // copies of the pivot panels (rows and columns indexed like the
+  // matrix, except that column panel rows start at the first pivot)
+  std::vector<int> col_panel;
+  std::vector<int> row_panel;
+  std::vector<const int*> col_rows;
+  std::vector<const int*> row_rows;
+};
+
+// sleeps until the generation might no longer be the given one
+inline void sleep_while(Barrier& b, unsigned generation) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<unsigned*>(&b.generation), FUTEX_WAIT, generation, nullptr, nullptr, 0);
+#else
+  usleep(20);
+#endif
+}
+
+// starts the next generation, waking the processes sleeping on it
+inline void next_generation(Barrier& b) {
+  b.generation.fetch_add(1);
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<unsigned*>(&b.generation), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+// Waits until all processes reach the barrier. Returns false if the
+// barrier is broken.
+inline bool barrier_wait(Barrier& b) {
+  unsigned generation = b.generation.load();
+  if (b.waiting.fetch_add(1) + 1 == b.count) {
+    // the last to arrive lets the others go
+    b.waiting.store(0);
+    next_generation(b);
+  }
+  while (b.generation.load() == generation && !b.broken) {
+    sleep_while(b, generation);
+  }
+  return !b.broken;
+}
+
+// breaks the barrier, releasing every process waiting on it
+inline void barrier_break(Barrier& b) {
+  b.broken = true;
+  next_generation(b);
+}
+
+// the rows or columns [first, last) of tile t
+inline int tile_first(const Layout& l, int t) { return t * l.tile; }
+inline int tile_last(const Layout& l, int t) { return std::min(l.n, (t + 1) * l.tile); }
+
+// whether process p owns tile (i,j)
+inline bool owns(const Layout& l, int p, int i, int j) {
+  return (i % l.rows) * l.cols + (j % l.cols) == p;
+}
+
+// d[i][j] = min(d[i][j], d[i][k] + d[k][j]) over the pivots k of tile
+// kt, for rows of tile it and columns of tile jt, reading d[i][k] as
+// pivot_col[i][k - col_offset] and d[k][j] as pivot_row[k][j]
+inline void relax_tile(const Layout& l, int kt, int it, int jt, int* const* row_i,
+                       const int* const* pivot_col, int col_offset, const int* const* pivot_row,
+                       AlgorithmStats* stats) {
+  int j0 = tile_first(l, jt);
+  int j1 = tile_last(l, jt);
+  for (int k = tile_first(l, kt); k < tile_last(l, kt); k++) {
+    for (int i = tile_first(l, it); i < tile_last(l, it); i++) {
+      int ik = pivot_col[i][k - col_offset];
+      if (ik == inf) {
+        continue;
+      }
+      const int* kj = pivot_row[k];
+      int* ij = row_i[i];
+      APSP_STAT(stats, relaxations, j1 - j0);
+      for (int j = j0; j < j1; j++) {
+        if (kj[j] != inf && (long long) ik + kj[j] < ij[j]) {
+          ij[j] = ik + kj[j];
+          APSP_STAT(stats, successful_relaxations, 1);
+        }
+      }
+    }
+  }
+}
+
+// the work of process p, using buffers b (doesn't allocate). Returns
+// false if the barrier was broken.
+inline bool worker(const Layout& l, int p, Buffers& b) {
+  AlgorithmStats* stats = &l.shared->stats[p];
+  int** row = b.row.data();
+  for (int i = 0; i < l.n; i++) {
+    row[i] = l.matrix + (long long) i * l.n;
+  }
+  int* col_panel = b.col_panel.data();
+  int* row_panel = b.row_panel.data();
+  const int** col_rows = b.col_rows.data();
+  const int** row_rows = b.row_rows.data();
+
+  for (int kt = 0; kt < l.tiles; kt++) {
+    int k0 = tile_first(l, kt);
+    int width = tile_last(l, kt) - k0;
+    APSP_STAT(stats, pivot_phases, p == 0 ? width : 0);
+
+    // phase 1: the pivot tile
+    if (owns(l, p, kt, kt)) {
+      relax_tile(l, kt, kt, kt, row, row, 0, row, stats);
+    }
+    if (!barrier_wait(l.shared->barrier)) {
+      return false;
+    }
+
+    // phase 2: the rest of the pivot row and column panels
+    for (int t = 0; t < l.tiles; t++) {
+      if (t != kt && owns(l, p, kt, t)) {
+        relax_tile(l, kt, kt, t, row, row, 0, row, stats);
+      }
+      if (t != kt && owns(l, p, t, kt)) {
+        relax_tile(l, kt, t, kt, row, row, 0, row, stats);
+      }
+    }
+    if (!barrier_wait(l.shared->barrier)) {
+      return false;
+    }
+
+    // receive the panels this process needs (its tile rows of the
+    // column panel, its tile columns of the row panel) once
+    for (int it = p / l.cols; it < l.tiles; it += l.rows) {
+      for (int i = tile_first(l, it); i < tile_last(l, it); i++) {
+        int* copy = col_panel + (long long) i * l.tile;
+        std::memcpy(copy, row[i] + k0, width * sizeof(int));
+        col_rows[i] = copy;
+      }
+    }
+    for (int k = k0; k < k0 + width; k++) {
+      int* copy = row_panel + (long long) (k - k0) * l.n;
+      for (int jt = p % l.cols; jt < l.tiles; jt += l.cols) {
+        int j0 = tile_first(l, jt);
+        std::memcpy(copy + j0, row[k] + j0, (tile_last(l, jt) - j0) * sizeof(int));
+      }
+      row_rows[k] = copy;
+    }
+
+    // phase 3: every other owned tile
+    for (int it = p / l.cols; it < l.tiles; it += l.rows) {
+      for (int jt = p % l.cols; jt < l.tiles; jt += l.cols) {
+        if (it != kt && jt != kt) {
+          relax_tile(l, kt, it, jt, row, col_rows, k0, row_rows, stats);
+        }
+      }
+    }
+    if (!barrier_wait(l.shared->barrier)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace process_fw
+
+
+inline std::vector<std::vector<int>> process_floyd_warshall(const Graph<int>& g, int processes, int tile,
+                                                            AlgorithmStats* stats) {
+  using namespace process_fw;
+  int n = g.node_count();
+  if (n == 0) {
+    return std::vector<std::vector<int>>();
+  }
+
+  Layout l;
+  l.n = n;
+  l.tile = std::max(1, std::min(tile, n));
+  l.tiles = (n + l.tile - 1) / l.tile;
+  processes = std::max(1, std::min({processes, l.tiles * l.tiles, 64}));
+  l.rows = 1;
+  for (int r = 1; r * r <= processes; r++) {
+    if (processes % r == 0) {
+      l.rows = r;
+    }
+  }
+  l.cols = processes / l.rows;
+
+  // shared mapping: header, then the matrix
+  size_t header = (sizeof(Shared) + 63) / 64 * 64;
+  size_t bytes = header + (size_t) n * n * sizeof(int);
+  void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return std::vector<std::vector<int>>();
+  }
+  l.shared = new (mapping) Shared();
+  l.matrix = reinterpret_cast<int*>(static_cast<char*>(mapping) + header);
+  APSP_STAT(stats, bytes_allocated, bytes);
+
+  for (int u = 0; u < n; u++) {
+    int* row = l.matrix + (long long) u * n;
+    std::fill(row, row + n, inf);
+    row[u] = 0;
+    for (const auto& [label, v] : g.out_edges(u)) {
+      if (v != u) {
+        row[v] = std::min(row[v], label.value());
+      }
+    }
+  }
+
+  l.shared->barrier.count = processes;
+
+  // workers 1..p-1 are children, the caller is worker 0. The children
+  // get copies of the buffers, so they don't allocate after the fork
+  // (another thread of the caller may have held the allocator's lock).
+  Buffers buffers(n, l.tile);
+  std::vector<pid_t> children;
+  bool failed = false;
+  for (int p = 1; p < processes; p++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      _exit(worker(l, p, buffers) ? 0 : 1);
+    }
+    if (pid < 0) {
+      failed = true;
+      break;
+    }
+    children.push_back(pid);
+  }
+  if (failed) {
+    // the barrier can never be passed, so stop the started workers
+    for (pid_t pid : children) {
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+    }
+  } else {
+    // a child that dies breaks the barrier, so the rest stop too
+    bool child_failed = false;
+    std::thread watchdog;
+    if (!children.empty()) {
+      watchdog = std::thread([&l, &children, &child_failed] {
+        for (pid_t pid : children) {
+          int status = 0;
+          if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            child_failed = true;
+            barrier_break(l.shared->barrier);
+          }
+        }
+      });
+    }
+    failed = !worker(l, 0, buffers);
+    if (watchdog.joinable()) {
+      watchdog.join();
+    }
+    failed = failed || child_failed;
+  }
+
+  std::vector<std::vector<int>> dists;
+  if (!failed) {
+    for (int p = 0; p < processes; p++) {
+      APSP_STAT(stats, relaxations, l.shared->stats[p].relaxations);
+      APSP_STAT(stats, successful_relaxations, l.shared->stats[p].successful_relaxations);
+      APSP_STAT(stats, pivot_phases, l.shared->stats[p].pivot_phases);
+    }
+    bool negative_cycle = false;
+    for (int u = 0; u < n; u++) {
+      negative_cycle = negative_cycle || l.matrix[(long long) u * n + u] < 0;
+    }
+    if (!negative_cycle) {
+      dists.resize(n);
+      for (int u = 0; u < n; u++) {
+        dists[u].assign(l.matrix + (long long) u * n, l.matrix + (long long) (u + 1) * n);
+      }
+    }
+  }
+
+  munmap(mapping, bytes);
+  return dists;
+}
+
+
+#endif
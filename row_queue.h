@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------
+// FILE: row_queue.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: A bounded, blocking queue of distance matrix rows between one
+//       producer (e.g., GraphAlgorithms::johnsons_stream) and one
+//       consumer thread. Rows are passed by swapping vectors, and the
+//       consumer's used buffers go back to the producer, so a stream of
+//       any length only ever allocates about capacity + 2 rows.
+//----------------------------------------------------------------------
+
+
+#ifndef ROW_QUEUE_H
+#define ROW_QUEUE_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+
+class RowQueue
+{
+public:
+
+  // Constructor for a queue holding at most capacity (at least 1)
+  // finished rows
+  RowQueue(int capacity = 4);
+
+  // Producer: queues the row for source, blocking while the queue is
+  // full. The row's contents are moved into the queue and row is given
+  // a recycled buffer (with unspecified contents) in exchange. Returns
+  // false if the queue was closed.
+  bool push(int source, std::vector<int>& row);
+
+  // Consumer: takes the next row, blocking until one is queued. The
+  // buffer previously held by row is recycled. Returns false once the
+  // queue is closed and empty.
+  bool pop(int& source, std::vector<int>& row);
+
+  // Closes the queue (either side may call this). Later pushes fail,
+  // and pops fail once the queued rows are taken.
+  void close();
+
+  // Returns true if the queue has been closed
+  bool closed() const;
+
+private:
+  int capacity;
+  bool is_closed = false;
+  std::deque<std::pair<int, std::vector<int>>> rows;
+  std::vector<std::vector<int>> spare;  // recycled buffers
+  mutable std::mutex lock;
+  std::condition_variable not_full;
+  std::condition_variable not_empty;
+};
+
+
+inline RowQueue::RowQueue(int capacity) : capacity(capacity < 1 ? 1 : capacity) {
+}
+
+inline bool RowQueue::push(int source, std::vector<int>& row) {
+  std::unique_lock<std::mutex> guard(lock);
+  not_full.wait(guard, [this] { return is_closed || (int) rows.size() < capacity; });
+  if (is_closed) {
+    return false;
+  }
+  rows.emplace_back(source, std::vector<int>());
+  rows.back().second.swap(row);
+  if (!spare.empty()) {
+    row.swap(spare.back());
+    spare.pop_back();
+  }
+  not_empty.notify_one();
+  return true;
+}
+
+inline bool RowQueue::pop(int& source, std::vector<int>& row) {
+  std::unique_lock<std::mutex> guard(lock);
+  not_empty.wait(guard, [this] { return is_closed || !rows.empty(); });
+  if (rows.empty()) {
+    return false;
+  }
+  if (row.capacity() > 0) {
+    spare.emplace_back();
+    spare.back().swap(row);
+  }
+  source = rows.front().first;
+  row.swap(rows.front().second);
+  rows.pop_front();
+  not_full.notify_one();
+  return true;
+}
+
+inline void RowQueue::close() {
+  std::lock_guard<std::mutex> guard(lock);
+  is_closed = true;
+  not_full.notify_all();
+  not_empty.notify_all();
+}
+
+inline bool RowQueue::closed() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return is_closed;
+}
+
+
+#endif
@@ -0,0 +1,306 @@
+//----------------------------------------------------------------------
+// FILE: small_graph_batch.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: All-pairs shortest paths for many small graphs (at most 64
+//       nodes) at once. Each graph is padded to a fixed size bucket of
+//       8, 16, 32 or 64 nodes and packed with 15 other graphs of the
+//       same bucket so that entry (i,j) of the 16 graphs is one run of
+//       16 ints (a cache line). Floyd-Warshall then runs on a whole
+//       group at a time, with a kernel compiled for each bucket size,
+//       so every loop has a constant trip count and the innermost one
+//       works on the 16 graphs side by side in vector registers. The
+//       results come back in one buffer, one n x n table per graph.
+//
+//       Inside the kernels unreachable is inf = (1 << 30) - 1 and
+//       values are kept at or above -inf, so adding two entries never
+//       overflows an int. A graph is only accepted if no simple path
+//       can reach either bound (|label| * (n - 1) under 1 << 30).
+//----------------------------------------------------------------------
+
+
+#ifndef SMALL_GRAPH_BATCH_H
+#define SMALL_GRAPH_BATCH_H
+
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <cstdlib>
+#include <algorithm>
+#include "graph.h"
+
+
+namespace small_batch {
+
+// graphs per group (entries of one (i,j) pair side by side)
+const int lanes = 16;
+
+// unreachable inside the kernels
+const int inf = (1 << 30) - 1;
+
+// the bucket sizes (nodes per padded graph)
+const int bucket_sizes[] = {8, 16, 32, 64};
+const int bucket_count = 4;
+
+//----------------------------------------------------------------------
+// Runs Floyd-Warshall on groups of lanes N-node graphs in place.
+// Input:
+//  data -- the groups, each N * N * lanes ints with entry (i,j) of
+//          graph l at (i * N + j) * lanes + l
+//  groups -- the number of groups
+//----------------------------------------------------------------------
+template<int N>
+void floyd_warshall(int* data, long long groups) {
+  for (long long group = 0; group < groups; group++) {
+    int* d = data + group * N * N * lanes;
+    for (int k = 0; k < N; k++) {
+      const int* row_k = d + k * N * lanes;
+      for (int i = 0; i < N; i++) {
+        int* row_i = d + i * N * lanes;
+        int ik[lanes];
+        for (int l = 0; l < lanes; l++) {
+          ik[l] = row_i[k * lanes + l];
+        }
+        for (int j = 0; j < N; j++) {
+          int* ij = row_i + j * lanes;
+          const int* kj = row_k + j * lanes;
+          for (int l = 0; l < lanes; l++) {
+            // masks instead of branches, so the loop vectorizes
+            int unreachable = -((ik[l] == inf) | (kj[l] == inf));
+            int through = (std::max(ik[l] + kj[l], -inf) & ~unreachable) | (inf & unreachable);
+            ij[l] = std::min(ij[l], through);
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace small_batch
+
+
+class SmallGraphBatch
+{
+public:
+
+  // the largest graph a batch takes
+  static const int max_nodes = 64;
+
+  // Adds g to the batch. Returns its index, or -1 if it has more than
+  // max_nodes nodes or a label too large for the kernels.
+  int add(const Graph<int>& g);
+
+  // Adds a graph with n nodes and the given (x, label, y) edges (in
+  // both directions if not directed; for a repeated edge the smallest
+  // label is kept). Returns its index, or -1 as for add(g).
+  int add(int n, bool is_directed, const std::vector<std::tuple<int,int,int>>& edges);
+
+  // Returns the number of graphs added
+  int graph_count() const;
+
+  // Returns the number of nodes of graph g
+  int node_count(int g) const;
+
+  // Runs Floyd-Warshall on every graph added since the last solve.
+  // Graph g's table is then the node_count(g) x node_count(g) block
+  // (row major) at offset(g) in distances().
+  void solve();
+
+  // Returns the tables of all solved graphs, with
+  // numeric_limits<int>::max() for unreachable pairs
+  const std::vector<int>& distances() const;
+
+  // Returns the position of graph g's table in distances()
+  long long offset(int g) const;
+
+  // Returns true if graph g has a negative cycle (its table is then
+  // not meaningful)
+  bool negative_cycle(int g) const;
+
+  // Returns graph g's table, as GraphAlgorithms::floyd_warshall would
+  // (empty if the graph has a negative cycle)
+  std::vector<std::vector<int>> table(int g) const;
+
+  // Removes every graph
+  void clear();
+
+private:
+  // the packed groups of one bucket size, for graphs not yet solved
+  struct Bucket
+  {
+    std::vector<int> data;
+    std::vector<int> graphs;  // the graph in each lane
+  };
+
+  Bucket buckets[small_batch::bucket_count];
+  std::vector<int> nodes;
+  std::vector<long long> offsets;
+  std::vector<bool> negative;
+  std::vector<int> results;
+  long long total = 0;
+
+  // starts a graph with n nodes: returns its index and sets bucket and
+  // the start of its (unlabeled) entries, or returns -1
+  int start_graph(int n, int& bucket, int*& entries);
+
+  // sets entry (x,y) of a graph to at most label
+  static void set_entry(int* entries, int size, int x, int label, int y);
+
+  // returns true if label is small enough for an n-node graph
+  static bool label_fits(int n, int label);
+};
+
+
+inline int SmallGraphBatch::add(const Graph<int>& g) {
+  int n = g.node_count();
+  std::vector<std::tuple<int,int,int>> edges;
+  for (int x = 0; x < n && n <= max_nodes; x++) {
+    for (const auto& [label, y] : g.out_edges(x)) {
+      edges.emplace_back(x, label.value(), y);
+    }
+  }
+  // an undirected graph already lists each edge in both directions
+  return add(n, true, edges);
+}
+
+inline int SmallGraphBatch::add(int n, bool is_directed, const std::vector<std::tuple<int,int,int>>& edges) {
+  for (const auto& [x, label, y] : edges) {
+    if (x < 0 || x >= n || y < 0 || y >= n || !label_fits(n, label)) {
+      return -1;
+    }
+  }
+  int bucket;
+  int* entries;
+  int g = start_graph(n, bucket, entries);
+  if (g < 0) {
+    return -1;
+  }
+  int size = small_batch::bucket_sizes[bucket];
+  for (const auto& [x, label, y] : edges) {
+    set_entry(entries, size, x, label, y);
+    if (!is_directed) {
+      set_entry(entries, size, y, label, x);
+    }
+  }
+  return g;
+}
+
+inline int SmallGraphBatch::start_graph(int n, int& bucket, int*& entries) {
+  if (n < 0 || n > max_nodes) {
+    return -1;
+  }
+  bucket = 0;
+  while (small_batch::bucket_sizes[bucket] < n) {
+    bucket++;
+  }
+  int size = small_batch::bucket_sizes[bucket];
+  long long group_size = (long long) size * size * small_batch::lanes;
+  Bucket& b = buckets[bucket];
+  int lane = b.graphs.size() % small_batch::lanes;
+  if (lane == 0) {
+    // a new group: no edges, 0 on the diagonal
+    b.data.resize(b.data.size() + group_size, small_batch::inf);
+    int* group = b.data.data() + b.data.size() - group_size;
+    for (int i = 0; i < size; i++) {
+      std::fill_n(group + (long long) (i * size + i) * small_batch::lanes, small_batch::lanes, 0);
+    }
+  }
+  int g = nodes.size();
+  b.graphs.push_back(g);
+  nodes.push_back(n);
+  offsets.push_back(total);
+  negative.push_back(false);
+  total += (long long) n * n;
+  entries = b.data.data() + b.data.size() - group_size + lane;
+  return g;
+}
+
+inline void SmallGraphBatch::set_entry(int* entries, int size, int x, int label, int y) {
+  int& entry = entries[(long long) (x * size + y) * small_batch::lanes];
+  entry = std::min(entry, x == y ? std::min(0, label) : label);
+}
+
+inline bool SmallGraphBatch::label_fits(int n, int label) {
+  return (long long) std::abs((long long) label) * std::max(1, n - 1) < small_batch::inf;
+}
+
+inline int SmallGraphBatch::graph_count() const {
+  return nodes.size();
+}
+
+inline int SmallGraphBatch::node_count(int g) const {
+  return nodes[g];
+}
+
+inline void SmallGraphBatch::solve() {
+  results.resize(total, std::numeric_limits<int>::max());
+  for (int bucket = 0; bucket < small_batch::bucket_count; bucket++) {
+    Bucket& b = buckets[bucket];
+    int size = small_batch::bucket_sizes[bucket];
+    long long groups = (b.graphs.size() + small_batch::lanes - 1) / small_batch::lanes;
+    switch (size) {
+      case 8: small_batch::floyd_warshall<8>(b.data.data(), groups); break;
+      case 16: small_batch::floyd_warshall<16>(b.data.data(), groups); break;
+      case 32: small_batch::floyd_warshall<32>(b.data.data(), groups); break;
+      case 64: small_batch::floyd_warshall<64>(b.data.data(), groups); break;
+    }
+
+    // unpack each graph's n x n block
+    for (size_t k = 0; k < b.graphs.size(); k++) {
+      int g = b.graphs[k];
+      int n = nodes[g];
+      const int* entries = b.data.data() + (long long) (k / small_batch::lanes) * size * size * small_batch::lanes
+                           + k % small_batch::lanes;
+      int* table = results.data() + offsets[g];
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          int d = entries[(long long) (i * size + j) * small_batch::lanes];
+          table[i * n + j] = d == small_batch::inf ? std::numeric_limits<int>::max() : d;
+        }
+        negative[g] = negative[g] || table[i * n + i] < 0;
+      }
+    }
+    b.data.clear();
+    b.graphs.clear();
+  }
+}
+
+inline const std::vector<int>& SmallGraphBatch::distances() const {
+  return results;
+}
+
+inline long long SmallGraphBatch::offset(int g) const {
+  return offsets[g];
+}
+
+inline bool SmallGraphBatch::negative_cycle(int g) const {
+  return negative[g];
+}
+
+inline std::vector<std::vector<int>> SmallGraphBatch::table(int g) const {
+  std::vector<std::vector<int>> dists;
+  if (negative[g]) {
+    return dists;
+  }
+  int n = nodes[g];
+  for (int i = 0; i < n; i++) {
+    auto row = results.begin() + offsets[g] + (long long) i * n;
+    dists.emplace_back(row, row + n);
+  }
+  return dists;
+}
+
+inline void SmallGraphBatch::clear() {
+  for (auto& b : buckets) {
+    b.data.clear();
+    b.graphs.clear();
+  }
+  nodes.clear();
+  offsets.clear();
+  negative.clear();
+  results.clear();
+  total = 0;
+}
+
+
+#endif
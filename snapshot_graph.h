@@ -0,0 +1,428 @@
+//----------------------------------------------------------------------
+// FILE: snapshot_graph.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Versioned graph for edge updates while queries are running.
+//       Readers pin the current version (an immutable GraphSnapshot)
+//       without taking a lock and can run any of the engines on it. A
+//       single writer batches add_edge / rem_edge / set_label calls on
+//       a draft and publishes it as the next version. Versions share
+//       the edge lists of unchanged nodes (a list is copied the first
+//       time a draft changes it), so a publish costs O(n) plus the
+//       changed lists. Old versions are reclaimed once no reader has
+//       them pinned, which readers announce in hazard pointer slots.
+//----------------------------------------------------------------------
+
+
+#ifndef SNAPSHOT_GRAPH_H
+#define SNAPSHOT_GRAPH_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <algorithm>
+#include "graph.h"
+
+
+class GraphSnapshot : public Graph<int>
+{
+public:
+
+  // constructor for a graph with n nodes and no edges
+  GraphSnapshot(int n, bool is_directed);
+
+  // constructor that copies the edges of g
+  GraphSnapshot(const Graph<int>& g);
+
+  // Returns the version number (0 for the first)
+  long long version() const;
+
+  // Graph interface (see graph.h). The changing functions are only
+  // used by SnapshotGraph on its draft, since readers get a const
+  // snapshot.
+  bool is_directed() const;
+  bool has_edge(int x, int y) const;
+  void add_edge(int x, std::optional<int> label, int y);
+  void rem_edge(int x, int y);
+  std::optional<int> get_label(int x, int y) const;
+  void set_label(int x, const int& label, int y);
+  std::vector<int> out_nodes(int x) const;
+  std::vector<std::pair<std::optional<int>,int>> out_edges(int x) const;
+  std::vector<int> in_nodes(int x) const;
+  std::vector<int> adjacent(int x) const;
+  int node_count() const;
+  int edge_count() const;
+
+private:
+  friend class SnapshotGraph;
+
+  typedef std::vector<std::pair<std::optional<int>,int>> EdgeList;
+
+  int nodes;
+  int edges = 0;
+  bool directed;
+  long long number = 0;
+
+  // out edges of each node, shared with other versions until changed
+  std::vector<std::shared_ptr<const EdgeList>> out;
+
+  // returns the list of x for changing, copying it first if another
+  // version shares it
+  EdgeList& writable(int x);
+
+  // returns true if x and y are valid nodes
+  bool valid(int x, int y) const;
+};
+
+
+class SnapshotGraph
+{
+public:
+
+  // the number of readers that can hold a pin at the same time (more
+  // wait for a free slot)
+  static constexpr int max_readers = 128;
+
+  // a reader's hold on one version, released when destroyed
+  class Pin
+  {
+  public:
+    Pin(Pin&& other);
+    ~Pin();
+    Pin(const Pin&) = delete;
+    Pin& operator=(const Pin&) = delete;
+    Pin& operator=(Pin&&) = delete;
+
+    // Returns the pinned version
+    const GraphSnapshot& graph() const;
+    const GraphSnapshot* operator->() const;
+
+  private:
+    friend class SnapshotGraph;
+    Pin(std::atomic<const GraphSnapshot*>* slot, const GraphSnapshot* snapshot);
+
+    std::atomic<const GraphSnapshot*>* slot;
+    const GraphSnapshot* snapshot;
+  };
+
+  // constructor whose first version has n nodes and no edges
+  SnapshotGraph(int n, bool is_directed);
+
+  // constructor whose first version is a copy of g
+  SnapshotGraph(const Graph<int>& g);
+
+  // destructor (no pins may be left)
+  ~SnapshotGraph();
+
+  SnapshotGraph(const SnapshotGraph&) = delete;
+  SnapshotGraph& operator=(const SnapshotGraph&) = delete;
+
+  // Reader (any thread): pins and returns the latest published version
+  Pin pin() const;
+
+  // Writer (one thread at a time): queues a change for the next
+  // version, with the same meaning as in Graph
+  void add_edge(int x, int label, int y);
+  void rem_edge(int x, int y);
+  void set_label(int x, int label, int y);
+
+  // Writer: returns the number of changes waiting to be published
+  int pending_count() const;
+
+  // Writer: makes the queued changes visible as the next version (if
+  // there are any) and reclaims unpinned old versions. Returns the
+  // latest version number.
+  long long publish();
+
+  // Writer: frees the old versions no reader has pinned, and returns
+  // the number still pinned
+  int reclaim();
+
+  // Returns the latest published version number
+  long long version() const;
+
+private:
+  std::atomic<const GraphSnapshot*> current;
+  mutable std::atomic<const GraphSnapshot*> hazards[max_readers];
+
+  // writer state: the next version (created by the first change after
+  // a publish) and the replaced versions
+  std::unique_ptr<GraphSnapshot> draft;
+  int pending = 0;
+  std::vector<const GraphSnapshot*> retired;
+
+  // returns the draft, starting it from the current version if needed
+  GraphSnapshot& draft_graph();
+};
+
+
+inline GraphSnapshot::GraphSnapshot(int n, bool is_directed) : nodes(n), directed(is_directed) {
+  auto empty = std::make_shared<const EdgeList>();
+  out.assign(n, empty);
+}
+
+inline GraphSnapshot::GraphSnapshot(const Graph<int>& g)
+  : nodes(g.node_count()), edges(g.edge_count()), directed(g.is_directed()) {
+  out.reserve(nodes);
+  for (int x = 0; x < nodes; x++) {
+    out.push_back(std::make_shared<const EdgeList>(g.out_edges(x)));
+  }
+}
+
+inline long long GraphSnapshot::version() const {
+  return number;
+}
+
+inline GraphSnapshot::EdgeList& GraphSnapshot::writable(int x) {
+  if (out[x].use_count() > 1) {
+    out[x] = std::make_shared<const EdgeList>(*out[x]);
+  }
+  // only this version holds the list now
+  return const_cast<EdgeList&>(*out[x]);
+}
+
+inline bool GraphSnapshot::valid(int x, int y) const {
+  return x >= 0 && x < nodes && y >= 0 && y < nodes;
+}
+
+inline bool GraphSnapshot::is_directed() const {
+  return directed;
+}
+
+inline bool GraphSnapshot::has_edge(int x, int y) const {
+  return valid(x, y) && std::any_of(out[x]->begin(), out[x]->end(), [y](const auto& e) { return e.second == y; });
+}
+
+inline void GraphSnapshot::add_edge(int x, std::optional<int> label, int y) {
+  if (!valid(x, y) || has_edge(x, y)) {
+    return;
+  }
+  writable(x).emplace_back(label, y);
+  if (!directed && x != y) {
+    writable(y).emplace_back(label, x);
+  }
+  edges++;
+}
+
+inline void GraphSnapshot::rem_edge(int x, int y) {
+  if (!valid(x, y) || !has_edge(x, y)) {
+    return;
+  }
+  for (auto [from, to] : {std::make_pair(x, y), std::make_pair(y, x)}) {
+    EdgeList& list = writable(from);
+    auto it = std::find_if(list.begin(), list.end(), [to = to](const auto& e) { return e.second == to; });
+    if (it != list.end()) {
+      list.erase(it);
+    }
+    if (directed) {
+      break;
+    }
+  }
+  edges--;
+}
+
+inline std::optional<int> GraphSnapshot::get_label(int x, int y) const {
+  if (!valid(x, y)) {
+    return std::nullopt;
+  }
+  for (const auto& [label, to] : *out[x]) {
+    if (to == y) {
+      return label;
+    }
+  }
+  return std::nullopt;
+}
+
+inline void GraphSnapshot::set_label(int x, const int& label, int y) {
+  if (!valid(x, y) || !has_edge(x, y)) {
+    return;
+  }
+  for (auto [from, to] : {std::make_pair(x, y), std::make_pair(y, x)}) {
+    for (auto& e : writable(from)) {
+      if (e.second == to) {
+        e.first = label;
+        break;
+      }
+    }
+    if (directed) {
+      break;
+    }
+  }
+}
+
+inline std::vector<int> GraphSnapshot::out_nodes(int x) const {
+  std::vector<int> result;
+  if (x >= 0 && x < nodes) {
+    for (const auto& e : *out[x]) {
+      result.push_back(e.second);
+    }
+  }
+  return result;
+}
+
+inline std::vector<std::pair<std::optional<int>,int>> GraphSnapshot::out_edges(int x) const {
+  if (x < 0 || x >= nodes) {
+    return EdgeList();
+  }
+  return *out[x];
+}
+
+inline std::vector<int> GraphSnapshot::in_nodes(int x) const {
+  std::vector<int> result;
+  if (x < 0 || x >= nodes) {
+    return result;
+  }
+  for (int y = 0; y < nodes; y++) {
+    if (std::any_of(out[y]->begin(), out[y]->end(), [x](const auto& e) { return e.second == x; })) {
+      result.push_back(y);
+    }
+  }
+  return result;
+}
+
+inline std::vector<int> GraphSnapshot::adjacent(int x) const {
+  std::vector<int> result = out_nodes(x);
+  for (int y : in_nodes(x)) {
+    if (std::find(result.begin(), result.end(), y) == result.end()) {
+      result.push_back(y);
+    }
+  }
+  return result;
+}
+
+inline int GraphSnapshot::node_count() const {
+  return nodes;
+}
+
+inline int GraphSnapshot::edge_count() const {
+  return edges;
+}
+
+
+inline SnapshotGraph::Pin::Pin(std::atomic<const GraphSnapshot*>* slot, const GraphSnapshot* snapshot)
+  : slot(slot), snapshot(snapshot) {
+}
+
+inline SnapshotGraph::Pin::Pin(Pin&& other) : slot(other.slot), snapshot(other.snapshot) {
+  other.slot = nullptr;
+}
+
+inline SnapshotGraph::Pin::~Pin() {
+  if (slot) {
+    slot->store(nullptr, std::memory_order_release);
+  }
+}
+
+inline const GraphSnapshot& SnapshotGraph::Pin::graph() const {
+  return *snapshot;
+}
+
+inline const GraphSnapshot* SnapshotGraph::Pin::operator->() const {
+  return snapshot;
+}
+
+inline SnapshotGraph::SnapshotGraph(int n, bool is_directed) : current(new GraphSnapshot(n, is_directed)) {
+  for (auto& hazard : hazards) {
+    hazard.store(nullptr);
+  }
+}
+
+inline SnapshotGraph::SnapshotGraph(const Graph<int>& g) : current(new GraphSnapshot(g)) {
+  for (auto& hazard : hazards) {
+    hazard.store(nullptr);
+  }
+}
+
+inline SnapshotGraph::~SnapshotGraph() {
+  for (const GraphSnapshot* old : retired) {
+    delete old;
+  }
+  delete current.load();
+}
+
+inline SnapshotGraph::Pin SnapshotGraph::pin() const {
+  while (true) {
+    for (auto& hazard : hazards) {
+      // claim a free slot by announcing the current version in it
+      const GraphSnapshot* snapshot = current.load();
+      const GraphSnapshot* expected = nullptr;
+      if (!hazard.compare_exchange_strong(expected, snapshot)) {
+        continue;
+      }
+      // the version is safe once it is still current after being
+      // announced (the writer checks the slots after replacing it)
+      const GraphSnapshot* latest;
+      while ((latest = current.load()) != snapshot) {
+        snapshot = latest;
+        hazard.store(snapshot);
+      }
+      return Pin(&hazard, snapshot);
+    }
+    std::this_thread::yield();
+  }
+}
+
+inline GraphSnapshot& SnapshotGraph::draft_graph() {
+  if (!draft) {
+    draft = std::make_unique<GraphSnapshot>(*current.load());
+  }
+  return *draft;
+}
+
+inline void SnapshotGraph::add_edge(int x, int label, int y) {
+  draft_graph().add_edge(x, label, y);
+  pending++;
+}
+
+inline void SnapshotGraph::rem_edge(int x, int y) {
+  draft_graph().rem_edge(x, y);
+  pending++;
+}
+
+inline void SnapshotGraph::set_label(int x, int label, int y) {
+  draft_graph().set_label(x, label, y);
+  pending++;
+}
+
+inline int SnapshotGraph::pending_count() const {
+  return pending;
+}
+
+inline long long SnapshotGraph::publish() {
+  if (draft) {
+    draft->number = current.load()->number + 1;
+    retired.push_back(current.exchange(draft.release()));
+    pending = 0;
+  }
+  reclaim();
+  return version();
+}
+
+inline int SnapshotGraph::reclaim() {
+  std::vector<const GraphSnapshot*> pinned;
+  for (const auto& hazard : hazards) {
+    const GraphSnapshot* snapshot = hazard.load();
+    if (snapshot) {
+      pinned.push_back(snapshot);
+    }
+  }
+  std::vector<const GraphSnapshot*> kept;
+  for (const GraphSnapshot* old : retired) {
+    if (std::find(pinned.begin(), pinned.end(), old) != pinned.end()) {
+      kept.push_back(old);
+    } else {
+      delete old;
+    }
+  }
+  retired.swap(kept);
+  return retired.size();
+}
+
+inline long long SnapshotGraph::version() const {
+  return current.load()->number;
+}
+
+
+#endif
@@ -0,0 +1,109 @@
+//----------------------------------------------------------------------
+// FILE: static_graph.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Read-only compressed (CSR) snapshot of a Graph<int> with both
+//       outgoing and incoming edges stored in flat arrays. Used by the
+//       point-to-point search engines, which need cheap forward and
+//       reverse edge scans that Graph::in_nodes can't provide.
+//----------------------------------------------------------------------
+
+
+#ifndef STATIC_GRAPH_H
+#define STATIC_GRAPH_H
+
+#include <vector>
+#include "graph.h"
+
+
+class StaticGraph
+{
+public:
+
+  // an edge to (or, for incoming edges, from) node with the given label
+  struct Arc
+  {
+    int node;
+    int label;
+  };
+
+  // a contiguous range of arcs
+  struct ArcRange
+  {
+    const Arc* first;
+    const Arc* last;
+    const Arc* begin() const { return first; }
+    const Arc* end() const { return last; }
+    int size() const { return last - first; }
+  };
+
+  // constructor that snapshots the edges of g (unlabeled edges get
+  // label 0)
+  StaticGraph(const Graph<int>& g);
+
+  // Returns the total number of nodes in the graph.
+  int node_count() const;
+
+  // Returns the number of stored (directed) arcs. An undirected edge
+  // counts as two arcs.
+  long long arc_count() const;
+
+  // Returns the outgoing arcs of x
+  ArcRange out_arcs(int x) const;
+
+  // Returns the incoming arcs of x (arc.node is the predecessor)
+  ArcRange in_arcs(int x) const;
+
+private:
+  int nodes;
+
+  // arcs of node x are in [offsets[x], offsets[x+1])
+  std::vector<long long> out_offsets;
+  std::vector<Arc> out_list;
+  std::vector<long long> in_offsets;
+  std::vector<Arc> in_list;
+};
+
+
+inline StaticGraph::StaticGraph(const Graph<int>& g)
+  : nodes(g.node_count()), out_offsets(g.node_count() + 1, 0), in_offsets(g.node_count() + 1, 0) {
+  // outgoing arcs in node order
+  for (int x = 0; x < nodes; x++) {
+    for (const auto& [label, y] : g.out_edges(x)) {
+      out_list.push_back(Arc{y, label.value_or(0)});
+      in_offsets[y + 1]++;
+    }
+    out_offsets[x + 1] = out_list.size();
+  }
+
+  // incoming arcs by counting sort on the target
+  for (int x = 0; x < nodes; x++) {
+    in_offsets[x + 1] += in_offsets[x];
+  }
+  in_list.resize(out_list.size());
+  std::vector<long long> fill(in_offsets.begin(), in_offsets.end() - 1);
+  for (int x = 0; x < nodes; x++) {
+    for (long long i = out_offsets[x]; i < out_offsets[x + 1]; i++) {
+      in_list[fill[out_list[i].node]++] = Arc{x, out_list[i].label};
+    }
+  }
+}
+
+inline int StaticGraph::node_count() const {
+  return nodes;
+}
+
+inline long long StaticGraph::arc_count() const {
+  return out_list.size();
+}
+
+inline StaticGraph::ArcRange StaticGraph::out_arcs(int x) const {
+  return ArcRange{out_list.data() + out_offsets[x], out_list.data() + out_offsets[x + 1]};
+}
+
+inline StaticGraph::ArcRange StaticGraph::in_arcs(int x) const {
+  return ArcRange{in_list.data() + in_offsets[x], in_list.data() + in_offsets[x + 1]};
+}
+
+
+#endif
@@ -0,0 +1,104 @@
+//----------------------------------------------------------------------
+// FILE: symmetric_matrix.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Distance matrix for undirected graphs, where d(i,j) = d(j,i).
+//       Only the upper triangle (with the diagonal) is stored, packed
+//       row by row into one array: row i holds the n - i entries
+//       (i,i) ... (i,n-1). Takes n(n+1)/2 entries instead of n^2.
+//----------------------------------------------------------------------
+
+
+#ifndef SYMMETRIC_MATRIX_H
+#define SYMMETRIC_MATRIX_H
+
+#include <vector>
+#include <limits>
+
+
+class SymmetricMatrix
+{
+public:
+
+  // constructor for an n x n matrix with every entry set to value
+  SymmetricMatrix(int n = 0, int value = std::numeric_limits<int>::max());
+
+  // Returns the number of rows (and columns)
+  int size() const;
+
+  // Returns entry (i,j), the same as entry (j,i)
+  int at(int i, int j) const;
+
+  // Returns a reference to entry (i,j), shared with entry (j,i)
+  int& at(int i, int j);
+
+  // Returns row i in full (n entries)
+  std::vector<int> row(int i) const;
+
+  // Returns the full n x n matrix
+  std::vector<std::vector<int>> to_full() const;
+
+  // Returns the packed upper triangle, row i starting at
+  // row_offset(i)
+  const std::vector<int>& packed() const;
+  std::vector<int>& packed();
+
+  // Returns the position of entry (i,i) in the packed triangle (the
+  // entries (i,j) for j >= i follow it)
+  long long row_offset(int i) const;
+
+private:
+  int n;
+  std::vector<int> entries;
+};
+
+
+inline SymmetricMatrix::SymmetricMatrix(int n, int value) : n(n), entries((long long) n * (n + 1) / 2, value) {
+}
+
+inline int SymmetricMatrix::size() const {
+  return n;
+}
+
+inline long long SymmetricMatrix::row_offset(int i) const {
+  return (long long) i * n - (long long) i * (i - 1) / 2;
+}
+
+inline int SymmetricMatrix::at(int i, int j) const {
+  return i <= j ? entries[row_offset(i) + (j - i)] : entries[row_offset(j) + (i - j)];
+}
+
+inline int& SymmetricMatrix::at(int i, int j) {
+  return i <= j ? entries[row_offset(i) + (j - i)] : entries[row_offset(j) + (i - j)];
+}
+
+inline std::vector<int> SymmetricMatrix::row(int i) const {
+  std::vector<int> r(n);
+  for (int j = 0; j < n; j++) {
+    r[j] = at(i, j);
+  }
+  return r;
+}
+
+inline std::vector<std::vector<int>> SymmetricMatrix::to_full() const {
+  std::vector<std::vector<int>> full(n, std::vector<int>(n));
+  for (int i = 0; i < n; i++) {
+    const int* packed_row = entries.data() + row_offset(i);
+    for (int j = i; j < n; j++) {
+      full[i][j] = packed_row[j - i];
+      full[j][i] = packed_row[j - i];
+    }
+  }
+  return full;
+}
+
+inline const std::vector<int>& SymmetricMatrix::packed() const {
+  return entries;
+}
+
+inline std::vector<int>& SymmetricMatrix::packed() {
+  return entries;
+}
+
+
+#endif
@@ -7,11 +7,24 @@
 
 #include <chrono>
 #include <vector>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
 #include "util.h"
 #include "graph.h"
 
 #include <iostream>
 
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
 using namespace std::chrono;
 
 
@@ -114,33 +127,428 @@ void load_dense_mini_cycles(Graph<int>& g, double pct)
   }
 }
 
-double timed_load_sparse(Graph<int>& g)
+//----------------------------------------------------------------------
+// Synthetic generators
+//----------------------------------------------------------------------
+
+// small, fast random stream (splitmix64) so each chunk of a generator
+// can cheaply get its own independent, reproducible stream
+struct SplitMix
+{
+  uint64_t state;
+
+  SplitMix(uint64_t seed, uint64_t stream, uint64_t chunk)
+    : state(seed ^ (stream * 0x9e3779b97f4a7c15ULL) ^ (chunk * 0xbf58476d1ce4e5b9ULL))
+  {
+    next();
+  }
+
+  uint64_t next()
+  {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // uniform in [0, 1)
+  double uniform()
+  {
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  // uniform in [lo, hi]
+  int range(int lo, int hi)
+  {
+    return lo + (int) (next() % (uint64_t) (hi - lo + 1));
+  }
+};
+
+// random stream ids for the different uses within one seed
+const uint64_t edge_stream = 1;
+const uint64_t point_stream = 2;
+const uint64_t potential_stream = 3;
+
+// number of edges (or points) generated per random stream
+const long long chunk_size = 1 << 16;
+
+// runs f(chunk) for chunk = 0 .. chunks-1 over the given number of threads
+template<typename F>
+void parallel_chunks(long long chunks, int threads, F f)
+{
+  if (threads <= 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads > chunks)
+    threads = chunks;
+  if (threads <= 1) {
+    for (long long c = 0; c < chunks; ++c)
+      f(c);
+    return;
+  }
+  std::atomic<long long> next_chunk(0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+    workers.emplace_back([&]() {
+      for (long long c = next_chunk++; c < chunks; c = next_chunk++)
+        f(c);
+    });
+  for (auto& worker : workers)
+    worker.join();
+}
+
+// Reweights labels with random node potentials p, i.e., label(x,y) +=
+// p(x) - p(y). Every cycle keeps its (positive) total weight, so some
+// labels become negative but no negative cycles are created.
+void apply_potentials(std::vector<LabeledEdge>& edges, int n, unsigned long long seed,
+                      int max_label, int threads)
+{
+  std::vector<int> potential(n);
+  long long chunks = (n + chunk_size - 1) / chunk_size;
+  parallel_chunks(chunks, threads, [&](long long c) {
+    SplitMix rng(seed, potential_stream, c);
+    long long end = std::min<long long>(n, (c + 1) * chunk_size);
+    for (long long v = c * chunk_size; v < end; ++v)
+      potential[v] = rng.range(0, max_label);
+  });
+  chunks = (edges.size() + chunk_size - 1) / chunk_size;
+  parallel_chunks(chunks, threads, [&](long long c) {
+    long long end = std::min<long long>(edges.size(), (c + 1) * chunk_size);
+    for (long long i = c * chunk_size; i < end; ++i) {
+      auto& [x, label, y] = edges[i];
+      label += potential[x] - potential[y];
+    }
+  });
+}
+
+
+std::vector<LabeledEdge> generate_rmat(int n, long long m, unsigned long long seed,
+                                       bool negative, int max_label, int threads)
+{
+  if (n < 2 || m <= 0)
+    return std::vector<LabeledEdge>();
+  int scale = 0;
+  while ((1LL << scale) < n)
+    ++scale;
+
+  // quadrant probabilities (a, b, c; d is the rest)
+  const double a = 0.57, b = 0.19, c = 0.19;
+
+  std::vector<LabeledEdge> edges(m);
+  long long chunks = (m + chunk_size - 1) / chunk_size;
+  parallel_chunks(chunks, threads, [&](long long chunk) {
+    SplitMix rng(seed, edge_stream, chunk);
+    long long end = std::min(m, (chunk + 1) * chunk_size);
+    for (long long i = chunk * chunk_size; i < end; ++i) {
+      int x, y;
+      do {
+        x = 0;
+        y = 0;
+        for (int bit = 0; bit < scale; ++bit) {
+          double r = rng.uniform();
+          if (r >= a + b + c) {
+            x |= 1 << bit;
+            y |= 1 << bit;
+          }
+          else if (r >= a + b)
+            x |= 1 << bit;
+          else if (r >= a)
+            y |= 1 << bit;
+        }
+      } while (x >= n || y >= n || x == y);
+      edges[i] = LabeledEdge(x, rng.range(1, max_label), y);
+    }
+  });
+
+  if (negative)
+    apply_potentials(edges, n, seed, max_label, threads);
+  return edges;
+}
+
+
+std::vector<LabeledEdge> generate_grid(int rows, int cols, unsigned long long seed,
+                                       bool negative, int max_label, int threads)
+{
+  if (rows <= 0 || cols <= 0)
+    return std::vector<LabeledEdge>();
+
+  // each row has 2 edges per horizontal and (except the last) vertical
+  // neighbor pair
+  long long horizontal = 2LL * (cols - 1);
+  long long vertical = 2LL * cols;
+  long long total = rows * horizontal + (rows - 1) * vertical;
+  std::vector<LabeledEdge> edges(total);
+
+  parallel_chunks(rows, threads, [&](long long r) {
+    SplitMix rng(seed, edge_stream, r);
+    long long i = r * (horizontal + vertical);
+    for (int c = 0; c < cols; ++c) {
+      int x = r * cols + c;
+      if (c + 1 < cols) {
+        edges[i++] = LabeledEdge(x, rng.range(1, max_label), x + 1);
+        edges[i++] = LabeledEdge(x + 1, rng.range(1, max_label), x);
+      }
+      if (r + 1 < rows) {
+        edges[i++] = LabeledEdge(x, rng.range(1, max_label), x + cols);
+        edges[i++] = LabeledEdge(x + cols, rng.range(1, max_label), x);
+      }
+    }
+  });
+
+  if (negative)
+    apply_potentials(edges, rows * cols, seed, max_label, threads);
+  return edges;
+}
+
+
+std::vector<LabeledEdge> generate_geometric(int n, double radius, unsigned long long seed,
+                                            bool negative, int max_label, int threads)
+{
+  if (n <= 0 || radius <= 0)
+    return std::vector<LabeledEdge>();
+
+  // place the points
+  std::vector<double> px(n), py(n);
+  long long chunks = (n + chunk_size - 1) / chunk_size;
+  parallel_chunks(chunks, threads, [&](long long c) {
+    SplitMix rng(seed, point_stream, c);
+    long long end = std::min<long long>(n, (c + 1) * chunk_size);
+    for (long long v = c * chunk_size; v < end; ++v) {
+      px[v] = rng.uniform();
+      py[v] = rng.uniform();
+    }
+  });
+
+  // bucket the points into cells at least radius wide (counting sort,
+  // so each cell lists its points in increasing order)
+  int side = std::max(1, std::min((int) (1.0 / radius), (int) std::sqrt((double) n) + 1));
+  std::vector<int> cell_start(side * side + 1, 0);
+  std::vector<int> cell_points(n);
+  auto cell_of = [&](int v) {
+    int cx = std::min(side - 1, (int) (px[v] * side));
+    int cy = std::min(side - 1, (int) (py[v] * side));
+    return cy * side + cx;
+  };
+  for (int v = 0; v < n; ++v)
+    ++cell_start[cell_of(v) + 1];
+  for (int i = 0; i < side * side; ++i)
+    cell_start[i + 1] += cell_start[i];
+  std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+  for (int v = 0; v < n; ++v)
+    cell_points[fill[cell_of(v)]++] = v;
+
+  // connect nearby points one row of cells at a time
+  std::vector<std::vector<LabeledEdge>> row_edges(side);
+  double scale = max_label / radius;
+  parallel_chunks(side, threads, [&](long long cy) {
+    std::vector<LabeledEdge>& out = row_edges[cy];
+    for (int cx = 0; cx < side; ++cx) {
+      for (int i = cell_start[cy * side + cx]; i < cell_start[cy * side + cx + 1]; ++i) {
+        int x = cell_points[i];
+        for (int ny = std::max(0, (int) cy - 1); ny <= std::min(side - 1, (int) cy + 1); ++ny) {
+          for (int nx = std::max(0, cx - 1); nx <= std::min(side - 1, cx + 1); ++nx) {
+            for (int j = cell_start[ny * side + nx]; j < cell_start[ny * side + nx + 1]; ++j) {
+              int y = cell_points[j];
+              double dx = px[x] - px[y];
+              double dy = py[x] - py[y];
+              double d = std::sqrt(dx * dx + dy * dy);
+              if (x != y && d < radius)
+                out.push_back(LabeledEdge(x, std::max(1, (int) std::ceil(d * scale)), y));
+            }
+          }
+        }
+      }
+    }
+  });
+
+  std::vector<LabeledEdge> edges;
+  size_t total = 0;
+  for (auto& row : row_edges)
+    total += row.size();
+  edges.reserve(total);
+  for (auto& row : row_edges)
+    edges.insert(edges.end(), row.begin(), row.end());
+
+  if (negative)
+    apply_potentials(edges, n, seed, max_label, threads);
+  return edges;
+}
+
+
+void load_edges(Graph<int>& g, const std::vector<LabeledEdge>& edges)
+{
+  for (const auto& [x, label, y] : edges)
+    g.add_edge(x, label, y);
+}
+
+
+//----------------------------------------------------------------------
+// Hardware counters
+//----------------------------------------------------------------------
+
+HardwareCounters& HardwareCounters::operator+=(const HardwareCounters& other)
+{
+  long long* mine[] = {&cycles, &instructions, &l1d_misses, &llc_misses, &branch_misses};
+  const long long* theirs[] = {&other.cycles, &other.instructions, &other.l1d_misses,
+                               &other.llc_misses, &other.branch_misses};
+  for (int i = 0; i < hw_column_count; ++i) {
+    if (*theirs[i] < 0)
+      continue;
+    *mine[i] = (*mine[i] < 0 ? 0 : *mine[i]) + *theirs[i];
+  }
+  return *this;
+}
+
+
+#ifdef __linux__
+
+// file descriptors for each counter (in HardwareCounters order), -1 if
+// the counter could not be opened
+static int hw_fds[hw_column_count];
+static bool hw_opened = false;
+
+static int open_hw_counter(unsigned type, unsigned long long config)
+{
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // counters are opened individually (not as a group) so that one
+  // unsupported event doesn't disable the others. When there are more
+  // events than hardware counters the kernel rotates them, so each one
+  // also reports how long it was enabled and actually counting.
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void open_hw_counters()
+{
+  unsigned long long l1d_miss = PERF_COUNT_HW_CACHE_L1D |
+    (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  hw_fds[0] = open_hw_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  hw_fds[1] = open_hw_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  hw_fds[2] = open_hw_counter(PERF_TYPE_HW_CACHE, l1d_miss);
+  hw_fds[3] = open_hw_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  hw_fds[4] = open_hw_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+  hw_opened = true;
+}
+
+bool hw_counters_start()
+{
+  if (!hw_opened)
+    open_hw_counters();
+  bool available = false;
+  for (int fd : hw_fds) {
+    if (fd < 0)
+      continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    available = true;
+  }
+  return available;
+}
+
+HardwareCounters hw_counters_stop()
+{
+  long long values[hw_column_count];
+  for (int i = 0; i < hw_column_count; ++i) {
+    values[i] = -1;
+    if (!hw_opened || hw_fds[i] < 0)
+      continue;
+    ioctl(hw_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    // value, time enabled, time running
+    unsigned long long data[3];
+    if (read(hw_fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+      continue;
+    // scale up a count that was only running for part of the region
+    if (data[2] < data[1])
+      values[i] = (long long) ((double) data[0] * data[1] / data[2]);
+    else
+      values[i] = data[0];
+  }
+  HardwareCounters counters;
+  counters.cycles = values[0];
+  counters.instructions = values[1];
+  counters.l1d_misses = values[2];
+  counters.llc_misses = values[3];
+  counters.branch_misses = values[4];
+  return counters;
+}
+
+#else
+
+bool hw_counters_start()
+{
+  return false;
+}
+
+HardwareCounters hw_counters_stop()
+{
+  return HardwareCounters();
+}
+
+#endif
+
+
+void write_hw_columns(std::ostream& out, const HardwareCounters& counters)
+{
+  long long values[] = {counters.cycles, counters.instructions, counters.l1d_misses,
+                        counters.llc_misses, counters.branch_misses};
+  for (long long value : values) {
+    if (value < 0)
+      out << "NaN ";
+    else
+      out << value << " ";
+  }
+}
+
+
+//----------------------------------------------------------------------
+// Timing
+//----------------------------------------------------------------------
+
+double timed_load_sparse(Graph<int>& g, HardwareCounters* counters)
 {
+  if (counters)
+    hw_counters_start();
   auto t0 = high_resolution_clock::now();
   load_sparse(g);
   auto t1 = high_resolution_clock::now();
+  if (counters)
+    *counters += hw_counters_stop();
   return duration_cast<milliseconds>(t1 - t0).count();
 }
 
 
-double timed_load_dense(Graph<int>& g, double pct)
+double timed_load_dense(Graph<int>& g, double pct, HardwareCounters* counters)
 {
+  if (counters)
+    hw_counters_start();
   auto t0 = high_resolution_clock::now();
   load_dense(g, pct);
   auto t1 = high_resolution_clock::now();
+  if (counters)
+    *counters += hw_counters_stop();
   return duration_cast<milliseconds>(t1 - t0).count();
 }
 
 
-double timed_in_nodes(Graph<int>& g)
+double timed_in_nodes(Graph<int>& g, HardwareCounters* counters)
 {
   double total = 0.0;
   // sample 1% of nodes
   int n = g.node_count() / 100;
   for (int u = 0; u < n; ++u) {
+    if (counters)
+      hw_counters_start();
     auto t0 = high_resolution_clock::now();
     auto r = g.in_nodes(u);
     auto t1 = high_resolution_clock::now();
+    if (counters)
+      *counters += hw_counters_stop();
     total += duration_cast<microseconds>(t1 - t0).count();
   }
   if (n <= 0)
@@ -149,15 +557,19 @@ double timed_in_nodes(Graph<int>& g)
 }
 
 
-double timed_out_nodes(Graph<int>& g)
+double timed_out_nodes(Graph<int>& g, HardwareCounters* counters)
 {
   double total = 0.0;
   // sample 1% of nodes
   int n = g.node_count() / 100;
   for (int u = 0; u < n; ++u) {
+    if (counters)
+      hw_counters_start();
     auto t0 = high_resolution_clock::now();
     auto r = g.out_nodes(u);
     auto t1 = high_resolution_clock::now();
+    if (counters)
+      *counters += hw_counters_stop();
     total += duration_cast<microseconds>(t1 - t0).count();
   }
   if (n <= 0)
@@ -166,15 +578,19 @@ double timed_out_nodes(Graph<int>& g)
 }
 
 
-double timed_adjacent_nodes(Graph<int>& g)
+double timed_adjacent_nodes(Graph<int>& g, HardwareCounters* counters)
 {
   double total = 0.0;
   // sample 1% of nodes
   int n = g.node_count() / 100;
   for (int u = 0; u < n; ++u) {
+    if (counters)
+      hw_counters_start();
     auto t0 = high_resolution_clock::now();
     auto r = g.adjacent(u);
     auto t1 = high_resolution_clock::now();
+    if (counters)
+      *counters += hw_counters_stop();
     total += duration_cast<microseconds>(t1 - t0).count();
   }
   if (n <= 0)
@@ -9,9 +9,58 @@
 #define UTIL_H
 
 
+#include <ostream>
+#include <vector>
+#include <tuple>
 #include "graph.h"
 
 
+// a labeled edge (x, label, y), in the same order as Graph::add_edge
+typedef std::tuple<int,int,int> LabeledEdge;
+
+
+//----------------------------------------------------------------------
+// Hardware performance counter totals for a measured region (read via
+// Linux perf_event_open). A counter the kernel or CPU doesn't provide
+// (e.g., in a VM or with perf_event_paranoid too high), or that never
+// got a hardware counter during the region, is left at -1. Counts of
+// events the kernel multiplexed are scaled up to the whole region.
+//----------------------------------------------------------------------
+struct HardwareCounters
+{
+  long long cycles = -1;
+  long long instructions = -1;
+  long long l1d_misses = -1;
+  long long llc_misses = -1;
+  long long branch_misses = -1;
+
+  // adds the available counts in other to these counts
+  HardwareCounters& operator+=(const HardwareCounters& other);
+};
+
+// number of columns written by write_hw_columns()
+const int hw_column_count = 5;
+
+//----------------------------------------------------------------------
+// Starts counting hardware events for the calling thread. Counters are
+// opened once and reused for each region.
+// Returns: true if at least one counter is available
+//----------------------------------------------------------------------
+bool hw_counters_start();
+
+//----------------------------------------------------------------------
+// Stops counting and returns the counts since hw_counters_start()
+//----------------------------------------------------------------------
+HardwareCounters hw_counters_stop();
+
+//----------------------------------------------------------------------
+// Writes the counters as space-separated perf_output.dat columns
+// (cycles, instructions, L1d misses, LLC misses, branch misses), with
+// NaN for unavailable counters so gnuplot skips them.
+//----------------------------------------------------------------------
+void write_hw_columns(std::ostream& out, const HardwareCounters& counters);
+
+
 //----------------------------------------------------------------------
 // Add edges to given graph
 // Input: a graph g with n nodes and no edges
@@ -73,42 +122,97 @@ void load_dense_cyclic(Graph<int>& g, double pct);
 //----------------------------------------------------------------------
 void load_dense_mini_cycles(Graph<int>& g, double pct);
 
+//----------------------------------------------------------------------
+// Generates an R-MAT (recursive matrix / Kronecker) power-law graph
+// using the Graph500 quadrant probabilities (0.57, 0.19, 0.19, 0.05).
+// Self loops are dropped and duplicate edges are kept (loading them
+// into a graph keeps the first). Edges are generated in fixed-size
+// chunks with their own random streams, so the result only depends on
+// the seed and not on the number of threads.
+// Input: node count n, number of edges m to draw, random seed, true to
+//        allow negative labels (without negative cycles), maximum edge
+//        label before reweighting, number of threads (0 = one per core)
+// Output: the generated edges
+//----------------------------------------------------------------------
+std::vector<LabeledEdge> generate_rmat(int n, long long m, unsigned long long seed,
+                                       bool negative = false, int max_label = 100,
+                                       int threads = 0);
+
+//----------------------------------------------------------------------
+// Generates a road-like 2D grid graph. Each node (r,c) is connected in
+// both directions to its right and lower neighbors with independent
+// random labels. Node (r,c) is numbered r * cols + c.
+// Input: grid dimensions, random seed, true to allow negative labels
+//        (without negative cycles), maximum edge label before
+//        reweighting, number of threads (0 = one per core)
+// Output: the generated edges (about 4 * rows * cols)
+//----------------------------------------------------------------------
+std::vector<LabeledEdge> generate_grid(int rows, int cols, unsigned long long seed,
+                                       bool negative = false, int max_label = 100,
+                                       int threads = 0);
+
+//----------------------------------------------------------------------
+// Generates a random geometric graph: n points placed uniformly in the
+// unit square, with edges in both directions between points closer
+// than radius. Labels are the distance scaled by max_label / radius
+// (at least 1).
+// Input: node count n, connection radius, random seed, true to allow
+//        negative labels (without negative cycles), maximum edge label
+//        before reweighting, number of threads (0 = one per core)
+// Output: the generated edges
+//----------------------------------------------------------------------
+std::vector<LabeledEdge> generate_geometric(int n, double radius, unsigned long long seed,
+                                            bool negative = false, int max_label = 100,
+                                            int threads = 0);
+
+//----------------------------------------------------------------------
+// Add the given edges to the graph
+// Input: a graph g and edges whose nodes are in range for g
+// Output: g contains each edge (the first label wins for duplicates)
+//----------------------------------------------------------------------
+void load_edges(Graph<int>& g, const std::vector<LabeledEdge>& edges);
+
 //----------------------------------------------------------------------
 // The total time required to load edges to a given graph
-// Input: a graph g with n nodes and no edges
+// Input: a graph g with n nodes and no edges, optional hardware
+//        counters to add the region's counts to
 // Output: g consists of O(n) edges
 // Returns: total time required in milliseconds
 //----------------------------------------------------------------------
-double timed_load_sparse(Graph<int>& g);
+double timed_load_sparse(Graph<int>& g, HardwareCounters* counters = nullptr);
 
 //----------------------------------------------------------------------
 // The total time required to load edges to a given graph
-// Input: a graph g with n nodes and no edges and constant percentage
+// Input: a graph g with n nodes and no edges and constant percentage,
+//        optional hardware counters to add the region's counts to
 // Output: g consists of O(n^2) edges
 // Returns: total time required in milliseconds
 //----------------------------------------------------------------------
-double timed_load_dense(Graph<int>& g, double pct);
+double timed_load_dense(Graph<int>& g, double pct, HardwareCounters* counters = nullptr);
 
 //----------------------------------------------------------------------
 // Average time to obtain incoming nodes per graph node
-// Input: a graph g with n nodes 
+// Input: a graph g with n nodes, optional hardware counters to add the
+//        (total) counts of the sampled calls to
 // Returns: average time required per in node call in milliseconds
 //----------------------------------------------------------------------
-double timed_in_nodes(Graph<int>& g);
+double timed_in_nodes(Graph<int>& g, HardwareCounters* counters = nullptr);
 
 //----------------------------------------------------------------------
 // Average time to obtain outgoing nodes per graph node
-// Input: a graph g with n nodes 
+// Input: a graph g with n nodes, optional hardware counters to add the
+//        (total) counts of the sampled calls to
 // Returns: average time required per out node call in milliseconds
 //----------------------------------------------------------------------
-double timed_out_nodes(Graph<int>& g);
+double timed_out_nodes(Graph<int>& g, HardwareCounters* counters = nullptr);
 
 //----------------------------------------------------------------------
 // Average time to obtain adjacent nodes per graph node
-// Input: a graph g with n nodes 
+// Input: a graph g with n nodes, optional hardware counters to add the
+//        (total) counts of the sampled calls to
 // Returns: average time required per adjacent call in milliseconds
 //----------------------------------------------------------------------
-double timed_adjacent_nodes(Graph<int>& g);
+double timed_adjacent_nodes(Graph<int>& g, HardwareCounters* counters = nullptr);
 
 
 #endif
@@ -0,0 +1,258 @@
+//----------------------------------------------------------------------
+// FILE: vertex_order.h
+// AUTH: Zach Sahlin
+// DATE: Fall 2022
+// DESC: Relabels the vertices of a graph into a cache friendly order,
+//       so that the endpoints of an edge get nearby ids and the
+//       distance arrays the engines index by vertex are touched close
+//       together. The permuted graph is built with GraphBuilder, and
+//       tables computed on it are mapped back to the original ids.
+//----------------------------------------------------------------------
+
+
+#ifndef VERTEX_ORDER_H
+#define VERTEX_ORDER_H
+
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include "graph.h"
+#include "static_graph.h"
+#include "graph_builder.h"
+
+
+// how the new order is chosen
+enum class VertexOrdering
+{
+  rcm,     // reverse Cuthill-McKee (a small edge span)
+  bfs,     // breadth first search order from low degree vertices
+  degree   // by decreasing degree (hubs first)
+};
+
+
+class VertexOrder
+{
+public:
+
+  // Constructor that orders the vertices of g (edge directions are
+  // ignored)
+  VertexOrder(const Graph<int>& g, VertexOrdering ordering = VertexOrdering::rcm);
+
+  // Returns the new id of (original) vertex x
+  int new_id(int x) const;
+
+  // Returns the original id of (new) vertex x
+  int old_id(int x) const;
+
+  // Returns the total number of nodes in the graph.
+  int node_count() const;
+
+  // Returns a copy of g with every vertex x renamed new_id(x)
+  AdjacencyList<int> permute(const Graph<int>& g) const;
+
+  // Returns the table indexed by original ids for a table (such as the
+  // result of johnsons) computed on the permuted graph
+  std::vector<std::vector<int>> restore(const std::vector<std::vector<int>>& dists) const;
+
+  // Returns the average of |x - y| over the edges (x,y) of g, a simple
+  // measure of how far apart neighbors are stored
+  static double edge_span(const Graph<int>& g);
+
+private:
+  std::vector<int> to_new;
+  std::vector<int> to_old;
+
+  // undirected neighbors of x in the snapshot
+  static std::vector<int> neighbors(const StaticGraph& sg, int x);
+
+  // appends the breadth first search order from root to order, with
+  // the neighbors of each vertex in increasing degree order if sorted
+  static void bfs(const StaticGraph& sg, int root, bool sorted, std::vector<bool>& seen,
+                  std::vector<int>& order);
+};
+
+
+//----------------------------------------------------------------------
+// Computes the shortest paths between all pairs of vertices by running
+// the given engine on a reordered copy of the graph and mapping the
+// result back to the original ids.
+// Input:
+//  g -- the given directed weighted graph
+//  ordering -- how to reorder the vertices
+//  engine -- takes a Graph<int> and returns its distance table (e.g.,
+//            GraphAlgorithms<int>::johnsons)
+// Output: the table engine(g) would give (empty if the engine returns
+//         an empty table)
+//----------------------------------------------------------------------
+template<typename F>
+std::vector<std::vector<int>> reordered_apsp(const Graph<int>& g, VertexOrdering ordering, F engine) {
+  VertexOrder order(g, ordering);
+  return order.restore(engine(order.permute(g)));
+}
+
+
+inline VertexOrder::VertexOrder(const Graph<int>& g, VertexOrdering ordering)
+  : to_new(g.node_count()) {
+  int n = g.node_count();
+  StaticGraph sg(g);
+  std::vector<int> degree(n);
+  for (int x = 0; x < n; x++) {
+    degree[x] = sg.out_arcs(x).size() + sg.in_arcs(x).size();
+  }
+
+  if (ordering == VertexOrdering::degree) {
+    to_old.resize(n);
+    for (int x = 0; x < n; x++) {
+      to_old[x] = x;
+    }
+    std::stable_sort(to_old.begin(), to_old.end(), [&degree](int x, int y) { return degree[x] > degree[y]; });
+  } else {
+    // one search per component, each started from its lowest degree
+    // vertex
+    std::vector<int> by_degree(n);
+    for (int x = 0; x < n; x++) {
+      by_degree[x] = x;
+    }
+    std::stable_sort(by_degree.begin(), by_degree.end(), [&degree](int x, int y) { return degree[x] < degree[y]; });
+    std::vector<bool> seen(n, false);
+    bool rcm = ordering == VertexOrdering::rcm;
+    for (int root : by_degree) {
+      if (seen[root]) {
+        continue;
+      }
+      if (rcm) {
+        // move the root to a pseudo-peripheral vertex: the lowest
+        // degree vertex of the last level of a search from it, while
+        // that makes the search deeper
+        std::vector<bool> scratch(n, false);
+        std::vector<int> level_order;
+        int depth = -1;
+        for (int tries = 0; tries < 4; tries++) {
+          level_order.clear();
+          std::vector<int> level(1, root);
+          scratch[root] = true;
+          level_order.push_back(root);
+          int levels = 0;
+          std::vector<int> last;
+          while (!level.empty()) {
+            last = level;
+            std::vector<int> next;
+            for (int x : level) {
+              for (int y : neighbors(sg, x)) {
+                if (!scratch[y]) {
+                  scratch[y] = true;
+                  next.push_back(y);
+                  level_order.push_back(y);
+                }
+              }
+            }
+            level.swap(next);
+            levels++;
+          }
+          for (int x : level_order) {
+            scratch[x] = false;
+          }
+          if (levels <= depth) {
+            break;
+          }
+          depth = levels;
+          root = *std::min_element(last.begin(), last.end(),
+                                   [&degree](int x, int y) { return degree[x] < degree[y]; });
+        }
+      }
+      bfs(sg, root, rcm, seen, to_old);
+    }
+    if (rcm) {
+      std::reverse(to_old.begin(), to_old.end());
+    }
+  }
+
+  for (int x = 0; x < n; x++) {
+    to_new[to_old[x]] = x;
+  }
+}
+
+inline std::vector<int> VertexOrder::neighbors(const StaticGraph& sg, int x) {
+  std::vector<int> result;
+  for (const auto& arc : sg.out_arcs(x)) {
+    result.push_back(arc.node);
+  }
+  for (const auto& arc : sg.in_arcs(x)) {
+    result.push_back(arc.node);
+  }
+  return result;
+}
+
+inline void VertexOrder::bfs(const StaticGraph& sg, int root, bool sorted, std::vector<bool>& seen,
+                             std::vector<int>& order) {
+  size_t first = order.size();
+  seen[root] = true;
+  order.push_back(root);
+  for (size_t i = first; i < order.size(); i++) {
+    std::vector<int> next;
+    for (int y : neighbors(sg, order[i])) {
+      if (!seen[y]) {
+        seen[y] = true;
+        next.push_back(y);
+      }
+    }
+    if (sorted) {
+      std::stable_sort(next.begin(), next.end(), [&sg](int x, int y) {
+        return sg.out_arcs(x).size() + sg.in_arcs(x).size() < sg.out_arcs(y).size() + sg.in_arcs(y).size();
+      });
+    }
+    order.insert(order.end(), next.begin(), next.end());
+  }
+}
+
+inline int VertexOrder::new_id(int x) const {
+  return to_new[x];
+}
+
+inline int VertexOrder::old_id(int x) const {
+  return to_old[x];
+}
+
+inline int VertexOrder::node_count() const {
+  return to_new.size();
+}
+
+inline AdjacencyList<int> VertexOrder::permute(const Graph<int>& g) const {
+  GraphBuilder<int> builder(g.node_count(), g.is_directed());
+  for (int x = 0; x < g.node_count(); x++) {
+    for (const auto& [label, y] : g.out_edges(x)) {
+      builder.add_edge(to_new[x], label, to_new[y]);
+    }
+  }
+  return builder.build();
+}
+
+inline std::vector<std::vector<int>> VertexOrder::restore(const std::vector<std::vector<int>>& dists) const {
+  int n = dists.size();
+  if (n != node_count()) {
+    return std::vector<std::vector<int>>();
+  }
+  std::vector<std::vector<int>> result(n, std::vector<int>(n));
+  for (int x = 0; x < n; x++) {
+    const std::vector<int>& row = dists[to_new[x]];
+    for (int y = 0; y < n; y++) {
+      result[x][y] = row[to_new[y]];
+    }
+  }
+  return result;
+}
+
+inline double VertexOrder::edge_span(const Graph<int>& g) {
+  long long total = 0;
+  long long edges = 0;
+  for (int x = 0; x < g.node_count(); x++) {
+    for (int y : g.out_nodes(x)) {
+      total += std::abs(x - y);
+      edges++;
+    }
+  }
+  return edges == 0 ? 0 : (double) total / edges;
+}
+
+
+#endif